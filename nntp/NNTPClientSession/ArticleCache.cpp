@@ -0,0 +1,300 @@
+//
+// ArticleCache.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  ArticleCache
+//
+
+
+#include "ArticleCache.h"
+
+#include "Poco/DirectoryIterator.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Path.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/TemporaryFile.h"
+#include "Poco/Timestamp.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+Poco::UInt64 hashMessageId(const std::string& messageId)
+{
+    // FNV-1a
+    Poco::UInt64 hash = 14695981039346656037ULL;
+    for (unsigned char c : messageId)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+
+ArticleCache::ArticleCache(std::size_t maxBytes, const std::string& directory, Poco::UInt64 maxDiskBytes):
+    m_maxBytes(maxBytes),
+    m_directory(directory),
+    m_maxDiskBytes(maxDiskBytes)
+{
+    if (!m_directory.empty())
+    {
+        Poco::File(m_directory).createDirectories();
+        if (m_maxDiskBytes > 0)
+        {
+            Poco::FastMutex::ScopedLock lock(m_diskMutex);
+            trimDisk();
+        }
+    }
+}
+
+
+ArticleCache::~ArticleCache()
+{
+}
+
+
+ArticleCache::Article ArticleCache::find(const std::string& messageId)
+{
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        auto it = m_index.find(messageId);
+        if (it != m_index.end())
+        {
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            return it->second->article;
+        }
+    }
+
+    if (m_directory.empty())
+        return Article();
+
+    Article article = load(messageId);
+    if (article)
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        insert(messageId, article);
+    }
+    return article;
+}
+
+
+ArticleCache::Article ArticleCache::add(const std::string& messageId, std::string article)
+{
+    if (!m_directory.empty())
+        store(messageId, article);
+
+    Article stored = std::make_shared<const std::string>(std::move(article));
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    insert(messageId, stored);
+    return stored;
+}
+
+
+std::size_t ArticleCache::size() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_index.size();
+}
+
+
+std::size_t ArticleCache::bytes() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_bytes;
+}
+
+
+void ArticleCache::insert(const std::string& messageId, const Article& article)
+{
+    auto it = m_index.find(messageId);
+    if (it != m_index.end())
+    {
+        m_bytes -= it->second->messageId.size() + it->second->article->size();
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+
+    std::size_t cost = messageId.size() + article->size();
+    if (cost > m_maxBytes)
+        return;
+
+    while (m_bytes + cost > m_maxBytes && !m_lru.empty())
+    {
+        const Entry& victim = m_lru.back();
+        m_bytes -= victim.messageId.size() + victim.article->size();
+        m_index.erase(victim.messageId);
+        m_lru.pop_back();
+    }
+
+    m_lru.push_front(Entry{messageId, article});
+    m_index.emplace(messageId, m_lru.begin());
+    m_bytes += cost;
+}
+
+
+Poco::UInt64 ArticleCache::diskBytes() const
+{
+    Poco::FastMutex::ScopedLock lock(m_diskMutex);
+    return m_diskBytes;
+}
+
+
+std::string ArticleCache::pathFor(const std::string& messageId) const
+{
+    // spread files over 256 subdirectories to keep directory sizes sane
+    std::string name = Poco::NumberFormatter::formatHex(hashMessageId(messageId), 16);
+    Poco::Path path(m_directory);
+    path.makeDirectory();
+    path.pushDirectory(name.substr(0, 2));
+    path.setFileName(name);
+    return path.toString();
+}
+
+
+ArticleCache::Article ArticleCache::load(const std::string& messageId) const
+{
+    const std::string path = pathFor(messageId);
+    if (!Poco::File(path).exists())
+        return Article();
+
+    try
+    {
+        // the first line holds the message-id, guarding against hash collisions
+        Poco::FileInputStream in(path, std::ios::in | std::ios::binary);
+        std::string storedId;
+        std::getline(in, storedId);
+        if (storedId != messageId)
+            return Article();
+
+        std::string article;
+        Poco::StreamCopier::copyToString(in, article);
+        if (m_maxDiskBytes > 0)
+            touch(path);
+        return std::make_shared<const std::string>(std::move(article));
+    }
+    catch (const Poco::FileException&)
+    {
+        return Article();
+    }
+}
+
+
+void ArticleCache::touch(const std::string& path)
+{
+    // the modification time marks the last use, so that trimDisk() keeps the file
+    try
+    {
+        Poco::File(path).setLastModified(Poco::Timestamp());
+    }
+    catch (const Poco::FileException&)
+    {
+    }
+}
+
+
+void ArticleCache::store(const std::string& messageId, const std::string& article)
+{
+    const std::string path = pathFor(messageId);
+    const std::string directory = Poco::Path(path).parent().toString();
+
+    // write to a temporary file and rename it, so that concurrent
+    // readers never see a partially written article
+    std::string tempPath;
+    try
+    {
+        Poco::File(directory).createDirectories();
+        tempPath = Poco::TemporaryFile::tempName(directory);
+        Poco::FileOutputStream out(tempPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        out << messageId << '\n';
+        out.write(article.data(), static_cast<std::streamsize>(article.size()));
+        out.close();
+        if (!out)
+            throw Poco::WriteFileException(tempPath);
+        Poco::File(tempPath).renameTo(path);
+    }
+    catch (const Poco::FileException&)
+    {
+        // a truncated copy would be served from then on; keep the article in memory only
+        try
+        {
+            if (!tempPath.empty() && Poco::File(tempPath).exists())
+                Poco::File(tempPath).remove();
+        }
+        catch (const Poco::FileException&)
+        {
+        }
+        return;
+    }
+
+    if (m_maxDiskBytes > 0)
+    {
+        Poco::FastMutex::ScopedLock lock(m_diskMutex);
+        m_diskBytes += messageId.size() + 1 + article.size();
+        if (m_diskBytes > m_maxDiskBytes)
+            trimDisk();
+    }
+}
+
+
+void ArticleCache::trimDisk()
+{
+    struct CachedFile
+    {
+        Poco::Timestamp used;
+        Poco::UInt64 size;
+        std::string path;
+    };
+    std::vector<CachedFile> files;
+    Poco::UInt64 total = 0;
+    for (Poco::DirectoryIterator dir(m_directory), end; dir != end; ++dir)
+    {
+        if (!dir->isDirectory())
+            continue;
+        for (Poco::DirectoryIterator it(dir.path()); it != end; ++it)
+        {
+            // cached articles are named by 16 hex digits; leave files being written alone
+            if (it.name().size() != 16 || !it->isFile())
+                continue;
+            files.push_back(CachedFile{it->getLastModified(), it->getSize(), it.path().toString()});
+            total += files.back().size;
+        }
+    }
+
+    if (total > m_maxDiskBytes)
+    {
+        std::sort(files.begin(), files.end(), [](const CachedFile& a, const CachedFile& b) { return a.used < b.used; });
+        const Poco::UInt64 target = m_maxDiskBytes - m_maxDiskBytes/10;
+        for (const CachedFile& file : files)
+        {
+            if (total <= target)
+                break;
+            try
+            {
+                Poco::File(file.path).remove();
+                total -= file.size;
+            }
+            catch (const Poco::FileException&)
+            {
+                // removed by another process meanwhile
+            }
+        }
+    }
+    m_diskBytes = total;
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,119 @@
+//
+// ArticleCache.h
+//
+// Library: Net
+// Package: Mail
+// Module:  ArticleCache
+//
+// Definition of the ArticleCache class.
+//
+
+
+#ifndef Net_ArticleCache_INCLUDED
+#define Net_ArticleCache_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include "Poco/Mutex.h"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API ArticleCache
+    /// A thread-safe cache of raw articles keyed by message-id.
+    ///
+    /// Articles are kept in memory up to a byte budget and evicted
+    /// in least-recently-used order. If a directory is given, every
+    /// article is also written to disk, so that the cache survives
+    /// restarts and can be shared between processes; memory misses
+    /// fall back to the disk copy.
+    ///
+    /// The disk copies may be limited by a budget of their own. When
+    /// it is exceeded, the least recently used files are deleted
+    /// until a tenth of the budget is free again; the modification
+    /// time of a file records its last use. Articles that cannot be
+    /// written in full, e.g. on a full disk, are kept in memory only.
+    ///
+    /// Articles are stored as returned by the server, with lines
+    /// separated by CRLF and dot-stuffing removed.
+{
+public:
+    using Article = std::shared_ptr<const std::string>;
+
+    explicit ArticleCache(std::size_t maxBytes, const std::string& directory = std::string(), Poco::UInt64 maxDiskBytes = 0);
+        /// Creates a cache holding at most maxBytes of article
+        /// text in memory, backed by the given directory if it
+        /// is not empty. The files in the directory are limited
+        /// to maxDiskBytes, unless it is 0.
+
+    ~ArticleCache();
+
+    Article find(const std::string& messageId);
+        /// Returns the cached article, or an empty pointer
+        /// if the article is neither in memory nor on disk.
+
+    Article add(const std::string& messageId, std::string article);
+        /// Adds the article to the cache and returns the stored copy.
+
+    std::size_t size() const;
+        /// Returns the number of articles held in memory.
+
+    std::size_t bytes() const;
+        /// Returns the number of bytes held in memory.
+
+    std::size_t maxBytes() const;
+
+    Poco::UInt64 diskBytes() const;
+        /// Returns the number of bytes the cache directory is
+        /// estimated to hold, if it has a budget.
+
+private:
+    struct Entry
+    {
+        std::string messageId;
+        Article article;
+    };
+    using EntryList = std::list<Entry>;
+
+    void insert(const std::string& messageId, const Article& article);
+    std::string pathFor(const std::string& messageId) const;
+    Article load(const std::string& messageId) const;
+    void store(const std::string& messageId, const std::string& article);
+    static void touch(const std::string& path);
+    void trimDisk();
+        /// Counts the files in the directory, which other processes
+        /// may share, and deletes the least recently used ones if
+        /// they exceed the budget. Called with m_diskMutex held.
+
+    std::size_t m_maxBytes;
+    std::size_t m_bytes{};
+    std::string m_directory;
+    EntryList m_lru;
+    std::unordered_map<std::string, EntryList::iterator> m_index;
+    mutable Poco::FastMutex m_mutex;
+    Poco::UInt64 m_maxDiskBytes;
+    Poco::UInt64 m_diskBytes{};
+    mutable Poco::FastMutex m_diskMutex;
+};
+
+
+//
+// inlines
+//
+inline std::size_t ArticleCache::maxBytes() const
+{
+    return m_maxBytes;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_ArticleCache_INCLUDED
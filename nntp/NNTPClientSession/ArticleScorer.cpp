@@ -0,0 +1,324 @@
+//
+// ArticleScorer.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  ArticleScorer
+//
+
+
+#include "ArticleScorer.h"
+#include "MessageDate.h"
+
+#include "Poco/Environment.h"
+#include "Poco/Exception.h"
+#include "Poco/RegularExpression.h"
+#include "Poco/Thread.h"
+
+#include <algorithm>
+#include <charconv>
+#include <exception>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const Poco::Timestamp::TimeDiff MICROSECONDS_PER_DAY = Poco::Int64(86400)*1000000;
+
+std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+        text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+        text.remove_suffix(1);
+    return text;
+}
+
+std::string_view nextToken(std::string_view& text)
+{
+    text = trim(text);
+    const std::size_t end = std::min(text.find_first_of(" \t"), text.size());
+    const std::string_view token = text.substr(0, end);
+    text.remove_prefix(end);
+    return token;
+}
+
+bool parseNumber(std::string_view text, Poco::Int64& value)
+{
+    if (!text.empty() && text.front() == '+')
+        text.remove_prefix(1);
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+} // namespace
+
+
+ArticleScorer::ArticleScorer()
+{
+}
+
+
+ArticleScorer::~ArticleScorer()
+{
+}
+
+
+void ArticleScorer::load(std::istream& rules)
+{
+    std::string groups("*");
+    std::string line;
+    for (int number = 1; std::getline(rules, line); ++number)
+    {
+        const std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#')
+            continue;
+        if (text.front() == '[')
+        {
+            if (text.back() != ']')
+                throw Poco::SyntaxException("Unterminated group list in line " + std::to_string(number), line);
+            groups.assign(text.data() + 1, text.size() - 2);
+            continue;
+        }
+        try
+        {
+            addRule(groups, text);
+        }
+        catch (const Poco::Exception& exc)
+        {
+            throw Poco::SyntaxException("Invalid rule in line " + std::to_string(number), exc.message());
+        }
+    }
+}
+
+
+void ArticleScorer::addRule(const std::string& groups, std::string_view text)
+{
+    std::string_view rest = text;
+    const std::string_view score = nextToken(rest);
+    const std::string_view field = nextToken(rest);
+    const std::string_view test = nextToken(rest);
+    const std::string_view value = trim(rest);
+    if (test.size() != 1 || value.empty())
+        throw Poco::SyntaxException(std::string(text));
+
+    Rule rule;
+    rule.groups.compile(groups);
+    Poco::Int64 number = 0;
+    if (score == "kill")
+        rule.score = KILL_SCORE;
+    else if (parseNumber(score, number) && number > KILL_SCORE && number < -KILL_SCORE)
+        rule.score = static_cast<int>(number);
+    else
+        throw Poco::SyntaxException("Invalid score", std::string(score));
+    if (!parseField(field, rule.field))
+        throw Poco::SyntaxException("Unknown field", std::string(field));
+
+    const bool numeric = rule.field >= FIELD_DEPTH;
+    switch (test[0])
+    {
+    case '~':
+        rule.test = TEST_REGEX;
+        break;
+    case '=':
+        rule.test = numeric ? TEST_EQUAL : TEST_WILDMAT;
+        break;
+    case '<':
+        rule.test = TEST_LESS;
+        break;
+    case '>':
+        rule.test = TEST_GREATER;
+        break;
+    default:
+        throw Poco::SyntaxException("Unknown test", std::string(test));
+    }
+
+    if (numeric)
+    {
+        if (rule.test == TEST_REGEX || !parseNumber(value, rule.value))
+            throw Poco::SyntaxException("Invalid numeric test", std::string(text));
+        if (rule.field == FIELD_AGE)
+            rule.value *= MICROSECONDS_PER_DAY;
+    }
+    else if (rule.test == TEST_REGEX)
+    {
+        rule.regex = std::make_shared<Poco::RegularExpression>(std::string(value), Poco::RegularExpression::RE_CASELESS | Poco::RegularExpression::RE_UTF8);
+    }
+    else if (rule.test == TEST_WILDMAT)
+    {
+        rule.wildmat.compile(value);
+    }
+    else
+    {
+        throw Poco::SyntaxException("Invalid text test", std::string(text));
+    }
+    m_rules.push_back(std::move(rule));
+}
+
+
+void ArticleScorer::score(const std::string& group, const OverviewBatch& batch, std::vector<int>& scores, const Poco::Timestamp& now) const
+{
+    scores.assign(batch.size(), 0);
+
+    std::vector<const Rule*> rules;
+    for (const Rule& rule : m_rules)
+    {
+        if (rule.groups.match(group))
+            rules.push_back(&rule);
+    }
+    if (rules.empty() || batch.empty())
+        return;
+
+    // each thread takes a contiguous slice of rows and runs every rule
+    // over its columns; the slices are large enough not to share cache lines
+    const std::size_t threads = std::min<std::size_t>(std::max(Poco::Environment::processorCount(), 1u),
+        (batch.size() + MIN_PARALLEL_RECORDS - 1)/MIN_PARALLEL_RECORDS);
+    if (threads <= 1)
+    {
+        scoreRange(rules, batch, scores, 0, batch.size(), now.epochMicroseconds());
+        return;
+    }
+
+    const std::size_t slice = (batch.size() + threads - 1)/threads;
+    std::vector<std::unique_ptr<Poco::Thread>> workers;
+    std::vector<std::exception_ptr> errors(threads);
+    for (std::size_t i = 0; i < threads; ++i)
+    {
+        const std::size_t begin = i*slice;
+        const std::size_t end = std::min(begin + slice, batch.size());
+        workers.emplace_back(new Poco::Thread);
+        workers.back()->startFunc([&, i, begin, end]
+        {
+            try
+            {
+                scoreRange(rules, batch, scores, begin, end, now.epochMicroseconds());
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (const std::unique_ptr<Poco::Thread>& worker : workers)
+        worker->join();
+    for (const std::exception_ptr& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+
+void ArticleScorer::scoreRange(const std::vector<const Rule*>& rules, const OverviewBatch& batch, std::vector<int>& scores, std::size_t begin, std::size_t end, Poco::Timestamp::TimeVal now) const
+{
+    std::string buffer; // RegularExpression wants a std::string
+    Poco::RegularExpression::Match match;
+    std::vector<Poco::Timestamp::TimeDiff> ages;
+    for (const Rule* rule : rules)
+    {
+        const int score = rule->score;
+        switch (rule->field)
+        {
+        case FIELD_SUBJECT:
+        case FIELD_FROM:
+        case FIELD_MESSAGE_ID:
+        case FIELD_REFERENCES:
+        {
+            static const OverviewBatch::Field COLUMNS[] = {OverviewBatch::SUBJECT, OverviewBatch::FROM, OverviewBatch::MESSAGE_ID, OverviewBatch::REFERENCES};
+            const OverviewBatch::Field column = COLUMNS[rule->field];
+            if (rule->test == TEST_REGEX)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const std::string_view text = batch.text(column, i);
+                    buffer.assign(text.data(), text.size());
+                    // search, like a killfile pattern; match(buffer) alone must match the whole text
+                    if (rule->regex->match(buffer, 0, match) > 0)
+                        scores[i] += score;
+                }
+            }
+            else
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    if (rule->wildmat.match(batch.text(column, i)))
+                        scores[i] += score;
+                }
+            }
+            break;
+        }
+        case FIELD_AGE:
+            if (ages.empty())
+            {
+                // parsed once for all age rules; unparsable dates never match
+                ages.resize(end - begin);
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const Poco::Timestamp::TimeVal date = MessageDate::parse(batch.date(i));
+                    ages[i - begin] = date == 0 ? -1 : std::max<Poco::Timestamp::TimeDiff>(now - date, 0);
+                }
+            }
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const Poco::Int64 age = ages[i - begin];
+                if (age >= 0 && (rule->test == TEST_LESS ? age < rule->value
+                                 : rule->test == TEST_GREATER ? age > rule->value
+                                 : age / MICROSECONDS_PER_DAY == rule->value / MICROSECONDS_PER_DAY))
+                    scores[i] += score;
+            }
+            break;
+        default:
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const Poco::Int64 value = static_cast<Poco::Int64>(
+                    rule->field == FIELD_DEPTH ? depth(batch.references(i))
+                    : rule->field == FIELD_BYTES ? batch.bytes(i)
+                    : batch.lines(i));
+                if (rule->test == TEST_LESS ? value < rule->value
+                    : rule->test == TEST_GREATER ? value > rule->value
+                    : value == rule->value)
+                    scores[i] += score;
+            }
+            break;
+        }
+    }
+}
+
+
+bool ArticleScorer::parseField(std::string_view name, Field& field)
+{
+    static const std::pair<const char*, Field> FIELDS[] =
+    {
+        {"subject", FIELD_SUBJECT},
+        {"from", FIELD_FROM},
+        {"message-id", FIELD_MESSAGE_ID},
+        {"references", FIELD_REFERENCES},
+        {"depth", FIELD_DEPTH},
+        {"age", FIELD_AGE},
+        {"bytes", FIELD_BYTES},
+        {"lines", FIELD_LINES}
+    };
+    for (const auto& entry : FIELDS)
+    {
+        if (name == entry.first)
+        {
+            field = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+std::size_t ArticleScorer::depth(std::string_view references)
+{
+    return static_cast<std::size_t>(std::count(references.begin(), references.end(), '<'));
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,155 @@
+//
+// ArticleScorer.h
+//
+// Library: Net
+// Package: Mail
+// Module:  ArticleScorer
+//
+// Definition of the ArticleScorer class.
+//
+
+
+#ifndef Net_ArticleScorer_INCLUDED
+#define Net_ArticleScorer_INCLUDED
+
+
+#include "NNTPClientSession.h"
+#include "OverviewBatch.h"
+#include "Wildmat.h"
+
+#include "Poco/Timestamp.h"
+#include "Poco/Types.h"
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Poco {
+
+class RegularExpression;
+
+namespace Net {
+
+class NNTP_API ArticleScorer
+    /// Scores overview records against a list of rules, serving
+    /// both as a killfile and for ranking articles.
+    ///
+    /// Rules are read from text such as
+    ///
+    ///     # comment
+    ///     [comp.lang.*,!comp.lang.java.*]
+    ///     kill  subject    ~ make money fast
+    ///     -50   from       = *@example.com
+    ///     +100  references = *<1234@example.org>*
+    ///     -20   depth      > 10
+    ///     -10   age        > 30
+    ///     -5    bytes      > 100000
+    ///
+    /// A line in brackets is a wildmat selecting the groups the
+    /// following rules apply to; rules before the first one apply
+    /// everywhere. Each rule is a score (a signed number, or "kill"
+    /// for KILL_SCORE), a field and a test. Text fields (subject,
+    /// from, message-id, references) take '~' and a case-insensitive
+    /// regular expression, which may match anywhere in the field, or
+    /// '=' and a wildmat, which must match all of it. Numeric fields take
+    /// '<', '>' or '=' and a number: depth is the number of message-ids
+    /// in References, age is in days, bytes and lines are as in the
+    /// overview. The scores of all matching rules are added up.
+    ///
+    /// Rules are compiled when they are added. Scoring a batch runs
+    /// one rule at a time over a whole column, splitting large
+    /// batches between threads.
+{
+public:
+    enum
+    {
+        KILL_SCORE = -9999,           // scores at or below this hide an article
+        MIN_PARALLEL_RECORDS = 16384  // smaller batches are scored on one thread
+    };
+
+    ArticleScorer();
+    ~ArticleScorer();
+
+    void load(std::istream& rules);
+        /// Adds the rules read from the stream.
+        ///
+        /// Throws a SyntaxException naming the line of the first
+        /// malformed rule.
+
+    void addRule(const std::string& groups, std::string_view rule);
+        /// Adds a rule, as written in a rules file, for the groups
+        /// matching the given wildmat.
+
+    std::size_t size() const;
+        /// Returns the number of rules.
+
+    void score(const std::string& group, const OverviewBatch& batch, std::vector<int>& scores, const Poco::Timestamp& now = Poco::Timestamp()) const;
+        /// Stores the score of each record of the batch, taken from
+        /// the given group, in scores, resizing it to batch.size().
+
+    static bool killed(int score);
+
+private:
+    enum Field
+    {
+        FIELD_SUBJECT,
+        FIELD_FROM,
+        FIELD_MESSAGE_ID,
+        FIELD_REFERENCES,
+        FIELD_DEPTH,
+        FIELD_AGE,
+        FIELD_BYTES,
+        FIELD_LINES
+    };
+
+    enum Test
+    {
+        TEST_REGEX,
+        TEST_WILDMAT,
+        TEST_LESS,
+        TEST_GREATER,
+        TEST_EQUAL
+    };
+
+    struct Rule
+    {
+        Wildmat groups;
+        Field field;
+        Test test;
+        int score;
+        std::shared_ptr<Poco::RegularExpression> regex; // shared so that rules stay copyable
+        Wildmat wildmat;
+        Poco::Int64 value;
+    };
+
+    void scoreRange(const std::vector<const Rule*>& rules, const OverviewBatch& batch, std::vector<int>& scores, std::size_t begin, std::size_t end, Poco::Timestamp::TimeVal now) const;
+
+    static bool parseField(std::string_view name, Field& field);
+    static std::size_t depth(std::string_view references);
+
+    std::vector<Rule> m_rules;
+};
+
+
+//
+// inlines
+//
+inline std::size_t ArticleScorer::size() const
+{
+    return m_rules.size();
+}
+
+
+inline bool ArticleScorer::killed(int score)
+{
+    return score <= KILL_SCORE;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_ArticleScorer_INCLUDED
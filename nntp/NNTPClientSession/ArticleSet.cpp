@@ -0,0 +1,630 @@
+//
+// ArticleSet.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  ArticleSet
+//
+
+
+#include "ArticleSet.h"
+
+#include <algorithm>
+#include <charconv>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const Poco::UInt64 ALL_BITS = ~Poco::UInt64(0);
+
+inline unsigned bitCount(Poco::UInt64 word)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<unsigned>(__popcnt64(word));
+#elif defined(_MSC_VER)
+    return __popcnt(static_cast<unsigned>(word)) + __popcnt(static_cast<unsigned>(word >> 32));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(word));
+#endif
+}
+
+inline unsigned lowestBit(Poco::UInt64 word)
+    // word must not be zero
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(word)))
+        return index;
+    _BitScanForward(&index, static_cast<unsigned long>(word >> 32));
+    return index + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
+
+inline Poco::UInt64 wordMask(unsigned word, unsigned first, unsigned last)
+    // the bits of the given word that lie within first..last
+{
+    Poco::UInt64 mask = ALL_BITS;
+    if (word == first/64)
+        mask &= ALL_BITS << (first % 64);
+    if (word == last/64)
+        mask &= ALL_BITS >> (63 - last % 64);
+    return mask;
+}
+
+int findBit(const std::vector<Poco::UInt64>& bitmap, unsigned from, bool set)
+    // returns the first bit at or after from that is set (or clear), or -1
+{
+    for (unsigned word = from/64; word < bitmap.size(); ++word)
+    {
+        Poco::UInt64 bits = set ? bitmap[word] : ~bitmap[word];
+        if (word == from/64)
+            bits &= ALL_BITS << (from % 64);
+        if (bits)
+            return static_cast<int>(word*64 + lowestBit(bits));
+    }
+    return -1;
+}
+
+} // namespace
+
+
+ArticleSet::ArticleSet()
+{
+}
+
+
+ArticleSet::~ArticleSet()
+{
+}
+
+
+void ArticleSet::add(uint_t number)
+{
+    Chunk& chunk = insert(static_cast<Poco::UInt16>(number >> 16));
+    const Poco::UInt16 low = static_cast<Poco::UInt16>(number);
+    switch (chunk.kind)
+    {
+    case FULL:
+        return;
+    case ARRAY:
+    {
+        auto it = std::lower_bound(chunk.array.begin(), chunk.array.end(), low);
+        if (it != chunk.array.end() && *it == low)
+            return;
+        chunk.array.insert(it, low);
+        ++chunk.cardinality;
+        if (chunk.array.size() > ARRAY_MAX)
+            toBitmap(chunk);
+        return;
+    }
+    case BITMAP:
+        if (!(chunk.bitmap[low/64] & (Poco::UInt64(1) << (low % 64))))
+        {
+            chunk.bitmap[low/64] |= Poco::UInt64(1) << (low % 64);
+            ++chunk.cardinality;
+            optimize(chunk);
+        }
+        return;
+    }
+}
+
+
+void ArticleSet::add(uint_t first, uint_t last)
+{
+    for (Poco::UInt64 key = first >> 16; key <= (last >> 16) && first <= last; ++key)
+    {
+        const unsigned low = key == (first >> 16) ? (first & 0xFFFF) : 0;
+        const unsigned high = key == (last >> 16) ? (last & 0xFFFF) : 0xFFFF;
+        setRange(insert(static_cast<Poco::UInt16>(key)), low, high);
+    }
+}
+
+
+void ArticleSet::remove(uint_t number)
+{
+    remove(number, number);
+}
+
+
+void ArticleSet::remove(uint_t first, uint_t last)
+{
+    for (Poco::UInt64 key = first >> 16; key <= (last >> 16) && first <= last; ++key)
+    {
+        Chunk* chunk = find(static_cast<Poco::UInt16>(key));
+        if (!chunk)
+            continue;
+        const unsigned low = key == (first >> 16) ? (first & 0xFFFF) : 0;
+        const unsigned high = key == (last >> 16) ? (last & 0xFFFF) : 0xFFFF;
+        clearRange(*chunk, low, high);
+        if (chunk->cardinality == 0)
+            erase(chunk->key);
+    }
+}
+
+
+bool ArticleSet::contains(uint_t number) const
+{
+    const Chunk* chunk = find(static_cast<Poco::UInt16>(number >> 16));
+    return chunk && contains(*chunk, number & 0xFFFF);
+}
+
+
+std::size_t ArticleSet::count() const
+{
+    std::size_t total = 0;
+    for (const Chunk& chunk : m_chunks)
+        total += chunk.cardinality;
+    return total;
+}
+
+
+std::size_t ArticleSet::count(uint_t first, uint_t last) const
+{
+    if (first > last)
+        return 0;
+
+    const Poco::UInt16 firstKey = static_cast<Poco::UInt16>(first >> 16);
+    const Poco::UInt16 lastKey = static_cast<Poco::UInt16>(last >> 16);
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), firstKey,
+        [](const Chunk& chunk, Poco::UInt16 key) { return chunk.key < key; });
+    std::size_t total = 0;
+    for (; it != m_chunks.end() && it->key <= lastKey; ++it)
+    {
+        const unsigned low = it->key == firstKey ? (first & 0xFFFF) : 0;
+        const unsigned high = it->key == lastKey ? (last & 0xFFFF) : 0xFFFF;
+        total += low == 0 && high == 0xFFFF ? it->cardinality : countRange(*it, low, high);
+    }
+    return total;
+}
+
+
+void ArticleSet::clear()
+{
+    m_chunks.clear();
+}
+
+
+ArticleSet& ArticleSet::operator|=(const ArticleSet& other)
+{
+    for (const Chunk& theirs : other.m_chunks)
+    {
+        Chunk& ours = insert(theirs.key);
+        if (ours.kind == FULL)
+            continue;
+        if (theirs.kind == FULL)
+        {
+            ours = theirs;
+            continue;
+        }
+
+        std::vector<Poco::UInt64> bits = words(theirs);
+        toBitmap(ours);
+        ours.cardinality = 0;
+        for (unsigned i = 0; i < BITMAP_WORDS; ++i)
+        {
+            ours.bitmap[i] |= bits[i];
+            ours.cardinality += bitCount(ours.bitmap[i]);
+        }
+        optimize(ours);
+    }
+    return *this;
+}
+
+
+ArticleSet& ArticleSet::operator&=(const ArticleSet& other)
+{
+    std::vector<Chunk> result;
+    for (Chunk& ours : m_chunks)
+    {
+        const Chunk* theirs = other.find(ours.key);
+        if (!theirs)
+            continue;
+        if (theirs->kind != FULL)
+        {
+            if (ours.kind == FULL)
+            {
+                ours = *theirs;
+            }
+            else
+            {
+                std::vector<Poco::UInt64> bits = words(*theirs);
+                toBitmap(ours);
+                ours.cardinality = 0;
+                for (unsigned i = 0; i < BITMAP_WORDS; ++i)
+                {
+                    ours.bitmap[i] &= bits[i];
+                    ours.cardinality += bitCount(ours.bitmap[i]);
+                }
+                optimize(ours);
+            }
+        }
+        if (ours.cardinality != 0)
+            result.push_back(std::move(ours));
+    }
+    m_chunks.swap(result);
+    return *this;
+}
+
+
+ArticleSet& ArticleSet::operator-=(const ArticleSet& other)
+{
+    std::vector<Chunk> result;
+    for (Chunk& ours : m_chunks)
+    {
+        const Chunk* theirs = other.find(ours.key);
+        if (theirs)
+        {
+            if (theirs->kind == FULL)
+                continue;
+
+            std::vector<Poco::UInt64> bits = words(*theirs);
+            toBitmap(ours);
+            ours.cardinality = 0;
+            for (unsigned i = 0; i < BITMAP_WORDS; ++i)
+            {
+                ours.bitmap[i] &= ~bits[i];
+                ours.cardinality += bitCount(ours.bitmap[i]);
+            }
+            optimize(ours);
+        }
+        if (ours.cardinality != 0)
+            result.push_back(std::move(ours));
+    }
+    m_chunks.swap(result);
+    return *this;
+}
+
+
+bool ArticleSet::operator==(const ArticleSet& other) const
+{
+    // chunks are always kept in the representation their size calls for
+    return m_chunks.size() == other.m_chunks.size()
+        && std::equal(m_chunks.begin(), m_chunks.end(), other.m_chunks.begin(),
+            [](const Chunk& a, const Chunk& b)
+            {
+                return a.key == b.key && a.kind == b.kind && a.cardinality == b.cardinality
+                    && a.array == b.array && a.bitmap == b.bitmap;
+            });
+}
+
+
+uint_t ArticleSet::next(uint_t number) const
+{
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), static_cast<Poco::UInt16>(number >> 16),
+        [](const Chunk& chunk, Poco::UInt16 key) { return chunk.key < key; });
+    for (; it != m_chunks.end(); ++it)
+    {
+        const unsigned from = it->key == (number >> 16) ? (number & 0xFFFF) : 0;
+        const int low = next(*it, from);
+        if (low >= 0)
+            return (static_cast<uint_t>(it->key) << 16) | static_cast<uint_t>(low);
+    }
+    return 0;
+}
+
+
+std::string ArticleSet::toString() const
+{
+    std::string text;
+    appendTo(text);
+    return text;
+}
+
+
+void ArticleSet::appendTo(std::string& text) const
+{
+    char buffer[24];
+    bool any = false;
+    bool separate = false;
+    Poco::UInt64 runFirst = 0;
+    Poco::UInt64 runLast = 0;
+    auto emit = [&]()
+    {
+        if (!any)
+            return;
+        if (separate)
+            text += ',';
+        separate = true;
+        char* end = std::to_chars(buffer, buffer + sizeof(buffer), runFirst).ptr;
+        if (runLast != runFirst)
+        {
+            *end++ = '-';
+            end = std::to_chars(end, buffer + sizeof(buffer), runLast).ptr;
+        }
+        text.append(buffer, end);
+    };
+    auto extend = [&](Poco::UInt64 first, Poco::UInt64 last)
+    {
+        if (any && first == runLast + 1)
+        {
+            runLast = last;
+            return;
+        }
+        emit();
+        any = true;
+        runFirst = first;
+        runLast = last;
+    };
+
+    for (const Chunk& chunk : m_chunks)
+    {
+        const Poco::UInt64 base = static_cast<Poco::UInt64>(chunk.key) << 16;
+        switch (chunk.kind)
+        {
+        case FULL:
+            extend(base, base + 0xFFFF);
+            break;
+        case ARRAY:
+            for (Poco::UInt16 low : chunk.array)
+                extend(base + low, base + low);
+            break;
+        case BITMAP:
+            for (int first = findBit(chunk.bitmap, 0, true); first >= 0;)
+            {
+                int end = findBit(chunk.bitmap, static_cast<unsigned>(first), false);
+                const unsigned last = end < 0 ? 0xFFFF : static_cast<unsigned>(end - 1);
+                extend(base + first, base + last);
+                first = end < 0 ? -1 : findBit(chunk.bitmap, static_cast<unsigned>(end), true);
+            }
+            break;
+        }
+    }
+    emit();
+}
+
+
+bool ArticleSet::parse(std::string_view ranges)
+{
+    const char* p = ranges.data();
+    const char* const end = p + ranges.size();
+    while (p != end)
+    {
+        while (p != end && (*p == ' ' || *p == ','))
+            ++p;
+        if (p == end)
+            break;
+
+        uint_t first = 0;
+        auto result = std::from_chars(p, end, first);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        uint_t last = first;
+        if (p != end && *p == '-')
+        {
+            result = std::from_chars(p + 1, end, last);
+            if (result.ec != std::errc())
+                return false;
+            p = result.ptr;
+        }
+        if (p != end && *p != ',' && *p != ' ' && *p != '\r' && *p != '\n')
+            return false;
+        if (p != end && (*p == '\r' || *p == '\n'))
+            p = end;
+        if (first == 0)
+            first = 1; // "0" and "0-n" occur in old .newsrc files
+        if (first <= last)
+            add(first, last);
+    }
+    return true;
+}
+
+
+ArticleSet::Chunk* ArticleSet::find(Poco::UInt16 key)
+{
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), key,
+        [](const Chunk& chunk, Poco::UInt16 value) { return chunk.key < value; });
+    return it != m_chunks.end() && it->key == key ? &*it : nullptr;
+}
+
+
+const ArticleSet::Chunk* ArticleSet::find(Poco::UInt16 key) const
+{
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), key,
+        [](const Chunk& chunk, Poco::UInt16 value) { return chunk.key < value; });
+    return it != m_chunks.end() && it->key == key ? &*it : nullptr;
+}
+
+
+ArticleSet::Chunk& ArticleSet::insert(Poco::UInt16 key)
+{
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), key,
+        [](const Chunk& chunk, Poco::UInt16 value) { return chunk.key < value; });
+    if (it == m_chunks.end() || it->key != key)
+    {
+        it = m_chunks.insert(it, Chunk());
+        it->key = key;
+    }
+    return *it;
+}
+
+
+void ArticleSet::erase(Poco::UInt16 key)
+{
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), key,
+        [](const Chunk& chunk, Poco::UInt16 value) { return chunk.key < value; });
+    if (it != m_chunks.end() && it->key == key)
+        m_chunks.erase(it);
+}
+
+
+void ArticleSet::toBitmap(Chunk& chunk)
+{
+    if (chunk.kind == BITMAP)
+        return;
+
+    chunk.bitmap.assign(BITMAP_WORDS, chunk.kind == FULL ? ALL_BITS : 0);
+    for (Poco::UInt16 low : chunk.array)
+        chunk.bitmap[low/64] |= Poco::UInt64(1) << (low % 64);
+    chunk.array.clear();
+    chunk.array.shrink_to_fit();
+    chunk.kind = BITMAP;
+}
+
+
+void ArticleSet::optimize(Chunk& chunk)
+{
+    if (chunk.kind == ARRAY && chunk.array.size() > ARRAY_MAX)
+    {
+        toBitmap(chunk);
+    }
+    else if (chunk.kind == BITMAP && chunk.cardinality == CHUNK_BITS)
+    {
+        chunk.bitmap.clear();
+        chunk.bitmap.shrink_to_fit();
+        chunk.kind = FULL;
+    }
+    else if (chunk.kind == BITMAP && chunk.cardinality <= ARRAY_MAX)
+    {
+        chunk.array.clear();
+        chunk.array.reserve(chunk.cardinality);
+        for (unsigned word = 0; word < BITMAP_WORDS; ++word)
+        {
+            for (Poco::UInt64 bits = chunk.bitmap[word]; bits; bits &= bits - 1)
+                chunk.array.push_back(static_cast<Poco::UInt16>(word*64 + lowestBit(bits)));
+        }
+        chunk.bitmap.clear();
+        chunk.bitmap.shrink_to_fit();
+        chunk.kind = ARRAY;
+    }
+}
+
+
+void ArticleSet::setRange(Chunk& chunk, unsigned first, unsigned last)
+{
+    if (chunk.kind == FULL)
+        return;
+
+    if (chunk.kind == ARRAY)
+    {
+        auto begin = std::lower_bound(chunk.array.begin(), chunk.array.end(), first);
+        auto end = std::upper_bound(begin, chunk.array.end(), last);
+        const std::size_t size = chunk.array.size() - (end - begin) + (last - first + 1);
+        if (size <= ARRAY_MAX)
+        {
+            std::vector<Poco::UInt16> range;
+            range.reserve(last - first + 1);
+            for (unsigned low = first; low <= last; ++low)
+                range.push_back(static_cast<Poco::UInt16>(low));
+            begin = chunk.array.erase(begin, end);
+            chunk.array.insert(begin, range.begin(), range.end());
+            chunk.cardinality = static_cast<Poco::UInt32>(chunk.array.size());
+            return;
+        }
+    }
+
+    toBitmap(chunk);
+    for (unsigned word = first/64; word <= last/64; ++word)
+    {
+        const Poco::UInt64 mask = wordMask(word, first, last);
+        chunk.cardinality += bitCount(mask & ~chunk.bitmap[word]);
+        chunk.bitmap[word] |= mask;
+    }
+    optimize(chunk);
+}
+
+
+void ArticleSet::clearRange(Chunk& chunk, unsigned first, unsigned last)
+{
+    if (chunk.kind == ARRAY)
+    {
+        auto begin = std::lower_bound(chunk.array.begin(), chunk.array.end(), first);
+        auto end = std::upper_bound(begin, chunk.array.end(), last);
+        chunk.array.erase(begin, end);
+        chunk.cardinality = static_cast<Poco::UInt32>(chunk.array.size());
+        return;
+    }
+
+    toBitmap(chunk);
+    for (unsigned word = first/64; word <= last/64; ++word)
+    {
+        const Poco::UInt64 mask = wordMask(word, first, last);
+        chunk.cardinality -= bitCount(mask & chunk.bitmap[word]);
+        chunk.bitmap[word] &= ~mask;
+    }
+    optimize(chunk);
+}
+
+
+std::size_t ArticleSet::countRange(const Chunk& chunk, unsigned first, unsigned last)
+{
+    switch (chunk.kind)
+    {
+    case FULL:
+        return last - first + 1;
+    case ARRAY:
+    {
+        auto begin = std::lower_bound(chunk.array.begin(), chunk.array.end(), first);
+        return std::upper_bound(begin, chunk.array.end(), last) - begin;
+    }
+    case BITMAP:
+        break;
+    }
+
+    std::size_t total = 0;
+    for (unsigned word = first/64; word <= last/64; ++word)
+        total += bitCount(chunk.bitmap[word] & wordMask(word, first, last));
+    return total;
+}
+
+
+bool ArticleSet::contains(const Chunk& chunk, unsigned low)
+{
+    switch (chunk.kind)
+    {
+    case FULL:
+        return true;
+    case ARRAY:
+        return std::binary_search(chunk.array.begin(), chunk.array.end(), low);
+    case BITMAP:
+        break;
+    }
+    return (chunk.bitmap[low/64] >> (low % 64)) & 1;
+}
+
+
+int ArticleSet::next(const Chunk& chunk, unsigned low)
+{
+    switch (chunk.kind)
+    {
+    case FULL:
+        return static_cast<int>(low);
+    case ARRAY:
+    {
+        auto it = std::lower_bound(chunk.array.begin(), chunk.array.end(), low);
+        return it == chunk.array.end() ? -1 : *it;
+    }
+    case BITMAP:
+        break;
+    }
+    return findBit(chunk.bitmap, low, true);
+}
+
+
+std::vector<Poco::UInt64> ArticleSet::words(const Chunk& chunk)
+{
+    if (chunk.kind == BITMAP)
+        return chunk.bitmap;
+
+    std::vector<Poco::UInt64> bits(BITMAP_WORDS, chunk.kind == FULL ? ALL_BITS : 0);
+    for (Poco::UInt16 low : chunk.array)
+        bits[low/64] |= Poco::UInt64(1) << (low % 64);
+    return bits;
+}
+
+
+} } // namespace Poco::Net
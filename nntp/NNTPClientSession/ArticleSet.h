@@ -0,0 +1,152 @@
+//
+// ArticleSet.h
+//
+// Library: Net
+// Package: Mail
+// Module:  ArticleSet
+//
+// Definition of the ArticleSet class.
+//
+
+
+#ifndef Net_ArticleSet_INCLUDED
+#define Net_ArticleSet_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include "Poco/Types.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API ArticleSet
+    /// A compressed set of article numbers, as used for read
+    /// state in .newsrc files and for LISTGROUP results.
+    ///
+    /// Numbers are split by their upper 16 bits into chunks, in the
+    /// manner of roaring bitmaps. Each chunk is stored as a sorted
+    /// array while it holds few numbers, as a 65536-bit bitmap once
+    /// it gets denser, and as a mere flag once it is full, which is
+    /// the common case for long runs of read articles. Counting a
+    /// range or combining two sets works a chunk at a time with
+    /// word-wide operations.
+{
+public:
+    ArticleSet();
+    ~ArticleSet();
+
+    void add(uint_t number);
+    void add(uint_t first, uint_t last);
+        /// Adds all numbers from first to last inclusive.
+
+    void remove(uint_t number);
+    void remove(uint_t first, uint_t last);
+
+    bool contains(uint_t number) const;
+
+    std::size_t count() const;
+        /// Returns the number of elements.
+
+    std::size_t count(uint_t first, uint_t last) const;
+        /// Returns the number of elements from first to last inclusive.
+
+    bool empty() const;
+
+    void clear();
+
+    ArticleSet& operator|=(const ArticleSet& other);
+        /// Adds the elements of other.
+
+    ArticleSet& operator&=(const ArticleSet& other);
+        /// Keeps only the elements also in other.
+
+    ArticleSet& operator-=(const ArticleSet& other);
+        /// Removes the elements of other, e.g. the read articles
+        /// from a LISTGROUP result, leaving the unread ones.
+
+    bool operator==(const ArticleSet& other) const;
+
+    uint_t next(uint_t number) const;
+        /// Returns the smallest element greater than or equal to
+        /// number, or 0 if there is none.
+
+    std::string toString() const;
+        /// Formats the set as a .newsrc range list, e.g. "1-500,502".
+
+    void appendTo(std::string& text) const;
+        /// Appends the range list to text.
+
+    bool parse(std::string_view ranges);
+        /// Adds the numbers in a .newsrc range list. Returns false
+        /// if the list is malformed; valid ranges before the error
+        /// are kept.
+
+    void swap(ArticleSet& other);
+
+private:
+    enum Kind
+    {
+        ARRAY,
+        BITMAP,
+        FULL
+    };
+
+    enum
+    {
+        CHUNK_BITS = 65536,
+        BITMAP_WORDS = CHUNK_BITS/64,
+        ARRAY_MAX = 4096 // arrays beyond this are larger than a bitmap
+    };
+
+    struct Chunk
+    {
+        Poco::UInt16 key{};
+        Kind kind{ARRAY};
+        Poco::UInt32 cardinality{};
+        std::vector<Poco::UInt16> array;
+        std::vector<Poco::UInt64> bitmap;
+    };
+
+    Chunk* find(Poco::UInt16 key);
+    const Chunk* find(Poco::UInt16 key) const;
+    Chunk& insert(Poco::UInt16 key);
+    void erase(Poco::UInt16 key);
+
+    static void toBitmap(Chunk& chunk);
+    static void optimize(Chunk& chunk);
+    static void setRange(Chunk& chunk, unsigned first, unsigned last);
+    static void clearRange(Chunk& chunk, unsigned first, unsigned last);
+    static std::size_t countRange(const Chunk& chunk, unsigned first, unsigned last);
+    static bool contains(const Chunk& chunk, unsigned low);
+    static int next(const Chunk& chunk, unsigned low);
+    static std::vector<Poco::UInt64> words(const Chunk& chunk);
+
+    std::vector<Chunk> m_chunks; // sorted by key
+};
+
+
+//
+// inlines
+//
+inline bool ArticleSet::empty() const
+{
+    return m_chunks.empty();
+}
+
+
+inline void ArticleSet::swap(ArticleSet& other)
+{
+    m_chunks.swap(other.m_chunks);
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_ArticleSet_INCLUDED
@@ -0,0 +1,487 @@
+//
+// ArticleSpool.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  ArticleSpool
+//
+
+
+#include "ArticleSpool.h"
+
+#include "Poco/DirectoryIterator.h"
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Path.h"
+#include "Poco/TemporaryFile.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const char SEGMENT_MAGIC[8] = {'N', 'N', 'T', 'P', 'S', 'E', 'G', '1'};
+const char INDEX_MAGIC[8] = {'N', 'N', 'T', 'P', 'S', 'D', 'X', '1'};
+
+struct IndexRecord
+{
+    Poco::UInt64 block;
+    Poco::UInt32 offset;
+    Poco::UInt32 length;
+    Poco::UInt32 number;
+    Poco::UInt16 groupLength;
+    Poco::UInt16 messageIdLength;
+    // followed by the group and the message-id
+};
+
+std::string_view findMessageId(std::string_view article)
+{
+    static const char NAME[] = "message-id:";
+    const std::size_t nameLength = sizeof(NAME) - 1;
+    std::size_t pos = 0;
+    while (pos < article.size())
+    {
+        std::size_t end = article.find('\n', pos);
+        std::string_view line = article.substr(pos, end == std::string_view::npos ? end : end - pos);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.empty())
+            break; // end of the header
+
+        if (line.size() > nameLength && std::equal(NAME, NAME + nameLength, line.begin(),
+            [](char a, char b) { return a == (b >= 'A' && b <= 'Z' ? b - 'A' + 'a' : b); }))
+        {
+            line.remove_prefix(nameLength);
+            std::size_t first = line.find_first_not_of(" \t");
+            std::size_t last = line.find_last_not_of(" \t");
+            return first == std::string_view::npos ? std::string_view() : line.substr(first, last - first + 1);
+        }
+        if (end == std::string_view::npos)
+            break;
+        pos = end + 1;
+    }
+    return std::string_view();
+}
+
+unsigned long checksum(const std::string& dictionary)
+{
+    return adler32(adler32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(dictionary.data()), static_cast<uInt>(dictionary.size()));
+}
+
+} // namespace
+
+
+ArticleSpool::Writer::Writer(ArticleSpool& spool, Poco::UInt32 segment):
+    m_spool(spool),
+    m_segment(segment),
+    m_data(spool.segmentPath(segment, "seg"), std::ios::binary | std::ios::trunc),
+    m_index(spool.segmentPath(segment, "sdx"), std::ios::binary | std::ios::trunc),
+    m_size(sizeof(SEGMENT_MAGIC))
+{
+    m_data.write(SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    m_index.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    if (!m_data || !m_index)
+        throw CreateFileException("Cannot create spool segment", spool.segmentPath(segment, "seg"));
+}
+
+
+ArticleSpool::Writer::~Writer()
+{
+    try
+    {
+        flush();
+    }
+    catch (...)
+    {
+    }
+}
+
+
+ArticleSpool::Location ArticleSpool::Writer::append(std::string_view group, Poco::UInt32 number, std::string_view article)
+{
+    // a block only ever holds one group, so it can use its dictionary
+    if (group != m_group)
+    {
+        flush();
+        m_group.assign(group.data(), group.size());
+    }
+
+    Location location;
+    location.segment = m_segment;
+    location.block = m_size;
+    location.offset = static_cast<Poco::UInt32>(m_block.size());
+    location.length = static_cast<Poco::UInt32>(article.size());
+    m_block.append(article.data(), article.size());
+    m_pending.push_back(Pending{number, std::string(findMessageId(article)), location});
+    if (m_block.size() >= m_spool.m_blockSize)
+        flush();
+    return location;
+}
+
+
+void ArticleSpool::Writer::flush()
+{
+    if (m_block.empty())
+        return;
+
+    const Dictionary dictionary = m_spool.dictionary(m_group);
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+        throw DataException("Cannot initialize spool compression");
+    if (dictionary)
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary->data()), static_cast<uInt>(dictionary->size()));
+    m_compressed.resize(deflateBound(&stream, static_cast<uLong>(m_block.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(&m_block[0]);
+    stream.avail_in = static_cast<uInt>(m_block.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&m_compressed[0]);
+    stream.avail_out = static_cast<uInt>(m_compressed.size());
+    const int rc = deflate(&stream, Z_FINISH);
+    const Poco::UInt32 header[2] = {static_cast<Poco::UInt32>(stream.total_out), static_cast<Poco::UInt32>(m_block.size())};
+    deflateEnd(&stream);
+    if (rc != Z_STREAM_END)
+        throw DataException("Cannot compress spool block");
+
+    m_data.write(reinterpret_cast<const char*>(header), sizeof(header));
+    m_data.write(m_compressed.data(), header[0]);
+    m_data.flush();
+    if (!m_data)
+        throw WriteFileException("Cannot write spool segment", m_spool.segmentPath(m_segment, "seg"));
+
+    // index only what is safely in the segment
+    for (const Pending& article : m_pending)
+    {
+        IndexRecord record;
+        record.block = article.location.block;
+        record.offset = article.location.offset;
+        record.length = article.location.length;
+        record.number = article.number;
+        record.groupLength = static_cast<Poco::UInt16>(m_group.size());
+        record.messageIdLength = static_cast<Poco::UInt16>(article.messageId.size());
+        m_index.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        m_index.write(m_group.data(), record.groupLength);
+        m_index.write(article.messageId.data(), record.messageIdLength);
+    }
+    m_index.flush();
+    if (!m_index)
+        throw WriteFileException("Cannot write spool index", m_spool.segmentPath(m_segment, "sdx"));
+
+    m_size += sizeof(header) + header[0];
+    m_spool.indexed(m_group, m_pending);
+    m_block.clear();
+    m_pending.clear();
+}
+
+
+ArticleSpool::ArticleSpool(const std::string& directory, std::size_t blockSize):
+    m_directory(Poco::Path(directory).makeDirectory().toString()),
+    m_blockSize(blockSize)
+{
+    Poco::File(m_directory).createDirectories();
+    std::vector<std::pair<Poco::UInt32, std::string>> indexes;
+    for (Poco::DirectoryIterator it(m_directory), end; it != end; ++it)
+    {
+        const Poco::Path path(it.path());
+        const std::string extension = path.getExtension();
+        const std::string base = path.getBaseName();
+        Poco::UInt32 segment = 0;
+        if ((extension == "seg" || extension == "sdx")
+            && std::from_chars(base.data(), base.data() + base.size(), segment).ec == std::errc())
+        {
+            m_nextSegment = std::max(m_nextSegment, segment + 1);
+            if (extension == "sdx")
+                indexes.emplace_back(segment, path.toString());
+        }
+        else if (extension == "dict")
+        {
+            Dictionary dictionary = loadDictionary(path.toString());
+            m_dictionaries[checksum(*dictionary)] = dictionary;
+        }
+    }
+
+    // in the order written, so that the latest copy of an article spooled twice wins
+    std::sort(indexes.begin(), indexes.end());
+    for (const auto& index : indexes)
+        loadIndex(index.second, index.first);
+
+    // group dictionary assignments, the last one for a group wins
+    std::ifstream assignments(m_directory + "dictionaries");
+    std::string group;
+    unsigned long id;
+    while (assignments >> group >> std::hex >> id >> std::dec)
+    {
+        auto it = m_dictionaries.find(id);
+        if (it != m_dictionaries.end())
+            m_groupDictionaries[group] = it->second;
+    }
+}
+
+
+ArticleSpool::~ArticleSpool()
+{
+}
+
+
+std::unique_ptr<ArticleSpool::Writer> ArticleSpool::createWriter()
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return std::unique_ptr<Writer>(new Writer(*this, m_nextSegment++));
+}
+
+
+bool ArticleSpool::find(const std::string& messageId, Location& location) const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    auto it = m_messageIds.find(messageId);
+    if (it == m_messageIds.end())
+        return false;
+    location = it->second;
+    return true;
+}
+
+
+bool ArticleSpool::find(const std::string& group, Poco::UInt32 number, Location& location) const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    auto articles = m_numbers.find(group);
+    if (articles == m_numbers.end())
+        return false;
+    auto it = articles->second.find(number);
+    if (it == articles->second.end())
+        return false;
+    location = it->second;
+    return true;
+}
+
+
+std::string ArticleSpool::read(const Location& location) const
+{
+    const Block block = readBlock(location.segment, location.block);
+    if (static_cast<Poco::UInt64>(location.offset) + location.length > block->size())
+        throw DataException("Invalid spool location", segmentPath(location.segment, "seg"));
+    return block->substr(location.offset, location.length);
+}
+
+
+std::size_t ArticleSpool::size() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_count;
+}
+
+
+void ArticleSpool::setDictionary(const std::string& group, const std::string& text)
+{
+    const std::string trimmed = text.size() > MAX_DICTIONARY_SIZE ? text.substr(text.size() - MAX_DICTIONARY_SIZE) : text;
+    const unsigned long id = checksum(trimmed);
+    const std::string hex = Poco::NumberFormatter::formatHex(static_cast<Poco::UInt64>(id), 8);
+
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    Dictionary& dictionary = m_dictionaries[id];
+    if (!dictionary)
+    {
+        const std::string temp = Poco::TemporaryFile::tempName(m_directory);
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(trimmed.data(), static_cast<std::streamsize>(trimmed.size()));
+            if (!out)
+                throw WriteFileException("Cannot write spool dictionary", temp);
+        }
+        Poco::File(temp).renameTo(m_directory + hex + ".dict");
+        dictionary = std::make_shared<const std::string>(trimmed);
+    }
+    std::ofstream assignments(m_directory + "dictionaries", std::ios::app);
+    assignments << group << ' ' << hex << '\n';
+    if (!assignments)
+        throw WriteFileException("Cannot write spool dictionaries", m_directory + "dictionaries");
+    m_groupDictionaries[group] = dictionary;
+}
+
+
+bool ArticleSpool::hasDictionary(const std::string& group) const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_groupDictionaries.find(group) != m_groupDictionaries.end();
+}
+
+
+std::string ArticleSpool::trainDictionary(const std::vector<std::string>& samples)
+{
+    // count whole header lines and field names across the samples
+    std::unordered_map<std::string, std::size_t> counts;
+    for (const std::string& sample : samples)
+    {
+        std::string_view text(sample);
+        std::size_t pos = 0;
+        while (pos < text.size())
+        {
+            std::size_t end = text.find('\n', pos);
+            if (end == std::string_view::npos)
+                break;
+            std::string_view line = text.substr(pos, end + 1 - pos);
+            if (line == "\r\n" || line == "\n")
+                break;
+            ++counts[std::string(line)];
+            std::size_t colon = line.find(": ");
+            if (colon != std::string_view::npos && line[0] != ' ' && line[0] != '\t')
+                ++counts[std::string(line.substr(0, colon + 2))];
+            pos = end + 1;
+        }
+    }
+
+    std::vector<std::pair<std::size_t, std::string>> strings;
+    for (auto& entry : counts)
+    {
+        if (entry.second > 1)
+            strings.emplace_back(entry.second, entry.first);
+    }
+    std::sort(strings.begin(), strings.end());
+
+    std::string dictionary;
+    for (const auto& entry : strings)
+        dictionary += entry.second;
+    if (dictionary.size() > MAX_DICTIONARY_SIZE)
+        dictionary.erase(0, dictionary.size() - MAX_DICTIONARY_SIZE);
+    return dictionary;
+}
+
+
+void ArticleSpool::loadIndex(const std::string& path, Poco::UInt32 segment)
+{
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(INDEX_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0)
+        return;
+
+    IndexRecord record;
+    std::string group;
+    std::string messageId;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        group.resize(record.groupLength);
+        messageId.resize(record.messageIdLength);
+        in.read(&group[0], record.groupLength);
+        in.read(&messageId[0], record.messageIdLength);
+        if (!in)
+            break; // cut short by a crash
+
+        Location location;
+        location.segment = segment;
+        location.block = record.block;
+        location.offset = record.offset;
+        location.length = record.length;
+        if (m_numbers[group].insert_or_assign(record.number, location).second)
+            ++m_count;
+        if (!messageId.empty())
+            m_messageIds[messageId] = location;
+    }
+}
+
+
+ArticleSpool::Dictionary ArticleSpool::loadDictionary(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return std::make_shared<const std::string>(std::move(text));
+}
+
+
+ArticleSpool::Dictionary ArticleSpool::dictionary(const std::string& group) const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    auto it = m_groupDictionaries.find(group);
+    return it == m_groupDictionaries.end() ? Dictionary() : it->second;
+}
+
+
+void ArticleSpool::indexed(const std::string& group, const std::vector<Writer::Pending>& articles)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    std::unordered_map<Poco::UInt32, Location>& numbers = m_numbers[group];
+    for (const Writer::Pending& article : articles)
+    {
+        if (numbers.insert_or_assign(article.number, article.location).second)
+            ++m_count;
+        if (!article.messageId.empty())
+            m_messageIds[article.messageId] = article.location;
+    }
+}
+
+
+ArticleSpool::Block ArticleSpool::readBlock(Poco::UInt32 segment, Poco::UInt64 offset) const
+{
+    {
+        // sequential reads mostly hit the block read last
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        if (m_cached && m_cachedBlock.segment == segment && m_cachedBlock.block == offset)
+            return m_cached;
+    }
+
+    const std::string path = segmentPath(segment, "seg");
+    std::ifstream in(path, std::ios::binary);
+    Poco::UInt32 header[2] = {};
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    std::string compressed(header[0], '\0');
+    in.read(&compressed[0], header[0]);
+    if (!in)
+        throw DataException("Truncated spool block", path);
+
+    std::string data(header[1], '\0');
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK)
+        throw DataException("Cannot initialize spool decompression");
+    stream.next_in = reinterpret_cast<Bytef*>(&compressed[0]);
+    stream.avail_in = header[0];
+    stream.next_out = reinterpret_cast<Bytef*>(&data[0]);
+    stream.avail_out = header[1];
+    int rc = inflate(&stream, Z_FINISH);
+    if (rc == Z_NEED_DICT)
+    {
+        Dictionary dictionary;
+        {
+            Poco::FastMutex::ScopedLock lock(m_mutex);
+            auto it = m_dictionaries.find(stream.adler);
+            if (it != m_dictionaries.end())
+                dictionary = it->second;
+        }
+        if (dictionary)
+        {
+            inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary->data()), static_cast<uInt>(dictionary->size()));
+            rc = inflate(&stream, Z_FINISH);
+        }
+    }
+    const uLong size = stream.total_out;
+    inflateEnd(&stream);
+    if (rc != Z_STREAM_END || size != header[1])
+        throw DataException(rc == Z_NEED_DICT ? "Missing spool dictionary" : "Corrupt spool block", path);
+
+    Block block = std::make_shared<const std::string>(std::move(data));
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    m_cachedBlock.segment = segment;
+    m_cachedBlock.block = offset;
+    m_cached = block;
+    return block;
+}
+
+
+std::string ArticleSpool::segmentPath(Poco::UInt32 segment, const char* extension) const
+{
+    return m_directory + Poco::NumberFormatter::format0(segment, 8) + '.' + extension;
+}
+
+
+} } // namespace Poco::Net
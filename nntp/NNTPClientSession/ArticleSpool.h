@@ -0,0 +1,221 @@
+//
+// ArticleSpool.h
+//
+// Library: Net
+// Package: Mail
+// Module:  ArticleSpool
+//
+// Definition of the ArticleSpool class.
+//
+
+
+#ifndef Net_ArticleSpool_INCLUDED
+#define Net_ArticleSpool_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include "Poco/Mutex.h"
+#include "Poco/Types.h"
+
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API ArticleSpool
+    /// An on-disk archive of raw articles made of large
+    /// append-only segments.
+    ///
+    /// Articles are collected into blocks of about blockSize()
+    /// bytes, each compressed with deflate on its own, so reading
+    /// any article costs a single block decompression. Blocks only
+    /// ever hold articles of one group, and a group may have a
+    /// preset dictionary (see setDictionary()), which lets even the
+    /// first headers of a block compress well.
+    ///
+    /// A directory holds, for each segment NNNNNNNN, the segment
+    /// NNNNNNNN.seg ("NNTPSEG1", then blocks of a {compressed size,
+    /// size} header followed by zlib data) and a sidecar index
+    /// NNNNNNNN.sdx ("NNTPSDX1", then one record per article giving
+    /// block offset, offset and length within the block, article
+    /// number, group and message-id). Dictionaries are kept as
+    /// <adler-32>.dict, named by the checksum zlib records in the
+    /// blocks that use them, and the file "dictionaries" maps each
+    /// group to its current one. Index records are written only
+    /// after their block, so a crash never leaves the index pointing
+    /// at missing data. The indexes are loaded into memory when the
+    /// spool is opened.
+    ///
+    /// Articles are added through a Writer, each of which appends to
+    /// a segment of its own; several writers may be used from
+    /// different threads. All other member functions are thread-safe.
+{
+public:
+    struct Location
+    {
+        Poco::UInt32 segment{};
+        Poco::UInt64 block{};  /// Offset of the block in the segment.
+        Poco::UInt32 offset{}; /// Offset of the article in the uncompressed block.
+        Poco::UInt32 length{};
+    };
+
+    class NNTP_API Writer
+        /// Appends articles to a new segment of the spool.
+    {
+    public:
+        ~Writer();
+            /// Writes the open block, if any.
+
+        Location append(std::string_view group, Poco::UInt32 number, std::string_view article);
+            /// Appends the unstuffed article, with CRLF line endings,
+            /// to the open block and returns where it will be stored.
+            /// The article becomes visible through the spool once its
+            /// block has been written.
+
+        void flush();
+            /// Compresses and writes the open block and indexes its
+            /// articles, making them durable.
+
+        Poco::UInt64 size() const;
+            /// Returns the number of bytes written to the segment.
+
+        Poco::UInt32 segment() const;
+
+    private:
+        struct Pending
+        {
+            Poco::UInt32 number;
+            std::string messageId;
+            Location location;
+        };
+
+        Writer(ArticleSpool& spool, Poco::UInt32 segment);
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        ArticleSpool& m_spool;
+        Poco::UInt32 m_segment;
+        std::ofstream m_data;
+        std::ofstream m_index;
+        Poco::UInt64 m_size;
+        std::string m_group;
+        std::string m_block;
+        std::string m_compressed;
+        std::vector<Pending> m_pending;
+
+        friend class ArticleSpool;
+    };
+
+    enum
+    {
+        DEFAULT_BLOCK_SIZE = 256*1024, // uncompressed bytes per block
+        MAX_DICTIONARY_SIZE = 32*1024  // the deflate window size
+    };
+
+    explicit ArticleSpool(const std::string& directory, std::size_t blockSize = DEFAULT_BLOCK_SIZE);
+        /// Opens or creates the spool in the given directory and
+        /// loads its indexes and dictionaries.
+
+    ~ArticleSpool();
+
+    std::unique_ptr<Writer> createWriter();
+        /// Starts a new segment and returns a writer for it.
+
+    bool find(const std::string& messageId, Location& location) const;
+        /// Looks up the article with the given message-id.
+
+    bool find(const std::string& group, Poco::UInt32 number, Location& location) const;
+        /// Looks up the article with the given number in the group.
+
+    std::string read(const Location& location) const;
+        /// Returns the article at the given location.
+        ///
+        /// Throws a DataException if the segment is damaged.
+
+    std::size_t size() const;
+        /// Returns the number of articles in the spool.
+
+    void setDictionary(const std::string& group, const std::string& dictionary);
+        /// Sets and stores the preset dictionary for blocks of the
+        /// given group; only its last MAX_DICTIONARY_SIZE bytes are
+        /// used. Blocks written earlier keep their dictionary.
+
+    bool hasDictionary(const std::string& group) const;
+
+    static std::string trainDictionary(const std::vector<std::string>& samples);
+        /// Builds a dictionary from sample articles out of the header
+        /// lines they share, the most frequent ones last, where
+        /// deflate finds them at the shortest distance.
+
+    std::size_t blockSize() const;
+
+    const std::string& directory() const;
+
+private:
+    using Dictionary = std::shared_ptr<const std::string>;
+    using Block = std::shared_ptr<const std::string>;
+
+    ArticleSpool(const ArticleSpool&) = delete;
+    ArticleSpool& operator=(const ArticleSpool&) = delete;
+
+    void loadIndex(const std::string& path, Poco::UInt32 segment);
+    Dictionary loadDictionary(const std::string& path);
+    Dictionary dictionary(const std::string& group) const;
+    void indexed(const std::string& group, const std::vector<Writer::Pending>& articles);
+    Block readBlock(Poco::UInt32 segment, Poco::UInt64 offset) const;
+    std::string segmentPath(Poco::UInt32 segment, const char* extension) const;
+
+    std::string m_directory;
+    std::size_t m_blockSize;
+    mutable Poco::FastMutex m_mutex;
+    Poco::UInt32 m_nextSegment{};
+    std::size_t m_count{};
+    std::unordered_map<std::string, Location> m_messageIds;
+    std::map<std::string, std::unordered_map<Poco::UInt32, Location>> m_numbers;
+    std::map<std::string, Dictionary> m_groupDictionaries;
+    std::unordered_map<unsigned long, Dictionary> m_dictionaries; /// by Adler-32, as named in zlib streams
+    mutable Location m_cachedBlock;
+    mutable Block m_cached;
+};
+
+
+//
+// inlines
+//
+inline Poco::UInt64 ArticleSpool::Writer::size() const
+{
+    return m_size;
+}
+
+
+inline Poco::UInt32 ArticleSpool::Writer::segment() const
+{
+    return m_segment;
+}
+
+
+inline std::size_t ArticleSpool::blockSize() const
+{
+    return m_blockSize;
+}
+
+
+inline const std::string& ArticleSpool::directory() const
+{
+    return m_directory;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_ArticleSpool_INCLUDED
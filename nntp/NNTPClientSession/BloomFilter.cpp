@@ -0,0 +1,143 @@
+//
+// BloomFilter.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  BloomFilter
+//
+
+
+#include "BloomFilter.h"
+
+#include "Poco/Exception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const char FILTER_MAGIC[8] = {'N', 'N', 'T', 'P', 'B', 'L', 'M', '1'};
+
+Poco::UInt64 mix(Poco::UInt64 h)
+{
+    // MurmurHash3 64-bit finalizer
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+} // namespace
+
+
+BloomFilter::BloomFilter()
+{
+}
+
+
+BloomFilter::BloomFilter(std::size_t expectedItems, double falsePositiveRate)
+{
+    const double ln2 = std::log(2.0);
+    const double items = static_cast<double>(std::max<std::size_t>(expectedItems, 1));
+    const double rate = std::min(std::max(falsePositiveRate, 1e-9), 0.5);
+    const double bits = -items*std::log(rate)/(ln2*ln2);
+
+    m_blocks = static_cast<std::size_t>(std::ceil(bits/(WORDS_PER_BLOCK*64)));
+    m_words.assign(m_blocks*WORDS_PER_BLOCK, 0);
+    m_hashCount = std::min(16, std::max(1, static_cast<int>(std::lround(bits/items*ln2))));
+}
+
+
+Poco::UInt64 BloomFilter::hash(const std::string& key)
+{
+    // FNV-1a over the bytes, then a finalizer to spread the bits
+    Poco::UInt64 h = 14695981039346656037ULL;
+    for (unsigned char c : key)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return mix(h);
+}
+
+
+void BloomFilter::add(Poco::UInt64 hash)
+{
+    if (m_blocks == 0)
+        return;
+
+    Poco::UInt64* block = &m_words[(hash % m_blocks)*WORDS_PER_BLOCK];
+    Poco::UInt64 h1 = hash >> 32;
+    const Poco::UInt64 h2 = (hash & 0xffffffffULL) | 1;
+    for (int i = 0; i < m_hashCount; ++i, h1 += h2)
+    {
+        const unsigned bit = static_cast<unsigned>(h1 & 511);
+        block[bit >> 6] |= Poco::UInt64(1) << (bit & 63);
+    }
+}
+
+
+bool BloomFilter::mayContain(Poco::UInt64 hash) const
+{
+    if (m_blocks == 0)
+        return false;
+
+    const Poco::UInt64* block = &m_words[(hash % m_blocks)*WORDS_PER_BLOCK];
+    Poco::UInt64 h1 = hash >> 32;
+    const Poco::UInt64 h2 = (hash & 0xffffffffULL) | 1;
+    for (int i = 0; i < m_hashCount; ++i, h1 += h2)
+    {
+        const unsigned bit = static_cast<unsigned>(h1 & 511);
+        if (!(block[bit >> 6] & (Poco::UInt64(1) << (bit & 63))))
+            return false;
+    }
+    return true;
+}
+
+
+void BloomFilter::clear()
+{
+    std::fill(m_words.begin(), m_words.end(), 0);
+}
+
+
+void BloomFilter::save(std::ostream& out) const
+{
+    // native byte order; the file is a local cache, not an exchange format
+    const Poco::UInt64 header[2] = {static_cast<Poco::UInt64>(m_blocks), static_cast<Poco::UInt64>(m_hashCount)};
+    out.write(FILTER_MAGIC, sizeof(FILTER_MAGIC));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(m_words.data()), static_cast<std::streamsize>(m_words.size()*sizeof(Poco::UInt64)));
+}
+
+
+void BloomFilter::load(std::istream& in)
+{
+    char magic[sizeof(FILTER_MAGIC)];
+    Poco::UInt64 header[2];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || std::memcmp(magic, FILTER_MAGIC, sizeof(magic)) != 0 || header[1] == 0 || header[1] > 16)
+        throw Poco::DataFormatException("Not a Bloom filter");
+
+    std::vector<Poco::UInt64> words(static_cast<std::size_t>(header[0])*WORDS_PER_BLOCK);
+    in.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(words.size()*sizeof(Poco::UInt64)));
+    if (!in)
+        throw Poco::DataFormatException("Truncated Bloom filter");
+
+    m_words.swap(words);
+    m_blocks = static_cast<std::size_t>(header[0]);
+    m_hashCount = static_cast<int>(header[1]);
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,96 @@
+//
+// BloomFilter.h
+//
+// Library: Net
+// Package: Mail
+// Module:  BloomFilter
+//
+// Definition of the BloomFilter class.
+//
+
+
+#ifndef Net_BloomFilter_INCLUDED
+#define Net_BloomFilter_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API BloomFilter
+    /// A blocked Bloom filter for approximate set membership.
+    ///
+    /// All probe bits for a key fall into a single 512-bit block,
+    /// i.e. one cache line, so a lookup costs one memory access
+    /// regardless of the number of hash functions. The filter never
+    /// reports false negatives; false positives occur at roughly the
+    /// rate it was sized for.
+    ///
+    /// Keys are added and tested by their 64-bit hash, see hash().
+{
+public:
+    BloomFilter();
+        /// Creates an empty filter that contains nothing.
+
+    BloomFilter(std::size_t expectedItems, double falsePositiveRate = 0.01);
+        /// Creates a filter sized for the given number of items
+        /// at the given false positive rate.
+
+    static Poco::UInt64 hash(const std::string& key);
+        /// Returns a well-mixed 64-bit hash of the key.
+
+    void add(Poco::UInt64 hash);
+    bool mayContain(Poco::UInt64 hash) const;
+        /// Returns false if the key has certainly not been added.
+
+    void clear();
+
+    std::size_t bits() const;
+    int hashCount() const;
+
+    void save(std::ostream& out) const;
+        /// Writes the filter in binary form.
+
+    void load(std::istream& in);
+        /// Reads a filter written by save().
+        ///
+        /// Throws a DataFormatException if the data is not a filter.
+
+private:
+    enum
+    {
+        WORDS_PER_BLOCK = 8 // 8 x 64 bits = one 64-byte cache line
+    };
+
+    std::vector<Poco::UInt64> m_words;
+    std::size_t m_blocks{};
+    int m_hashCount{};
+};
+
+
+//
+// inlines
+//
+inline std::size_t BloomFilter::bits() const
+{
+    return m_words.size()*64;
+}
+
+
+inline int BloomFilter::hashCount() const
+{
+    return m_hashCount;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_BloomFilter_INCLUDED
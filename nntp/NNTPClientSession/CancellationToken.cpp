@@ -0,0 +1,28 @@
+//
+// CancellationToken.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  CancellationToken
+//
+
+
+#include "CancellationToken.h"
+
+
+namespace Poco {
+namespace Net {
+
+
+CancellationToken::CancellationToken():
+    m_cancelled(false)
+{
+}
+
+
+CancellationToken::~CancellationToken()
+{
+}
+
+
+} } // namespace Poco::Net
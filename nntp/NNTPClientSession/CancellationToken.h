@@ -0,0 +1,75 @@
+//
+// CancellationToken.h
+//
+// Library: Net
+// Package: Mail
+// Module:  CancellationToken
+//
+// Definition of the CancellationToken class.
+//
+
+
+#ifndef Net_CancellationToken_INCLUDED
+#define Net_CancellationToken_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include <atomic>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API CancellationToken
+    /// A flag that one thread raises to make the NNTP commands that
+    /// other threads run under it give up, e.g. when a fetch worker
+    /// is shut down. See NNTPClientSession::OperationScope.
+    ///
+    /// Waiting sessions notice the flag within a fraction of a second;
+    /// they drop their connection and throw NNTPCancelledException.
+{
+public:
+    CancellationToken();
+    ~CancellationToken();
+
+    void cancel();
+        /// Raises the flag. May be called from any thread.
+
+    void reset();
+        /// Lowers the flag, so the token can be used again.
+
+    bool isCancelled() const;
+
+private:
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    std::atomic<bool> m_cancelled;
+};
+
+
+//
+// inlines
+//
+inline void CancellationToken::cancel()
+{
+    m_cancelled.store(true, std::memory_order_release);
+}
+
+
+inline void CancellationToken::reset()
+{
+    m_cancelled.store(false, std::memory_order_release);
+}
+
+
+inline bool CancellationToken::isCancelled() const
+{
+    return m_cancelled.load(std::memory_order_acquire);
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_CancellationToken_INCLUDED
@@ -0,0 +1,125 @@
+//
+// CommandLine.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  CommandLine
+//
+
+
+#include "CommandLine.h"
+
+#include <charconv>
+#include <cstring>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+constexpr std::string_view VERB_TEXT[] =
+{
+    "ARTICLE",
+    "AUTHINFO PASS",
+    "AUTHINFO SASL",
+    "AUTHINFO USER",
+    "BODY",
+    "CAPABILITIES",
+    "CHECK",
+    "DATE",
+    "GROUP",
+    "HEAD",
+    "LIST",
+    "LIST ACTIVE",
+    "LIST NEWSGROUPS",
+    "LISTGROUP",
+    "MODE STREAM",
+    "NEWGROUPS",
+    "OVER",
+    "POST",
+    "QUIT",
+    "STAT",
+    "TAKETHIS"
+};
+
+static_assert(sizeof(VERB_TEXT)/sizeof(VERB_TEXT[0]) == CommandLine::VERBS, "a verb lacks its text");
+
+} // namespace
+
+
+CommandLine::CommandLine(Verb verb):
+    m_size(0)
+{
+    const std::string_view text = VERB_TEXT[verb];
+    append(text.data(), text.size());
+    terminate();
+}
+
+
+CommandLine& CommandLine::arg(std::string_view argument)
+{
+    if (!argument.empty())
+    {
+        append(" ", 1);
+        append(argument.data(), argument.size());
+        terminate();
+    }
+    return *this;
+}
+
+
+CommandLine& CommandLine::arg(uint_t number)
+{
+    append(" ", 1);
+    append(number);
+    terminate();
+    return *this;
+}
+
+
+CommandLine& CommandLine::range(uint_t low, uint_t high)
+{
+    append(" ", 1);
+    append(low);
+    append("-", 1);
+    append(high);
+    terminate();
+    return *this;
+}
+
+
+std::string_view CommandLine::verb(Verb verb)
+{
+    return VERB_TEXT[verb];
+}
+
+
+void CommandLine::append(const char* data, std::size_t size)
+{
+    // two bytes stay free for the CRLF
+    if (size > MAX_LENGTH - 2 - m_size)
+        throw NNTPException("Command line too long", std::string(m_buffer, m_size));
+    std::memcpy(m_buffer + m_size, data, size);
+    m_size += size;
+}
+
+
+void CommandLine::append(uint_t number)
+{
+    char digits[16];
+    const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), number);
+    append(digits, static_cast<std::size_t>(result.ptr - digits));
+}
+
+
+void CommandLine::terminate()
+{
+    m_buffer[m_size] = '\r';
+    m_buffer[m_size + 1] = '\n';
+}
+
+
+} } // namespace Poco::Net
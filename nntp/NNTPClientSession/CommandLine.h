@@ -0,0 +1,106 @@
+//
+// CommandLine.h
+//
+// Library: Net
+// Package: Mail
+// Module:  CommandLine
+//
+// Definition of the CommandLine class.
+//
+
+
+#ifndef Net_CommandLine_INCLUDED
+#define Net_CommandLine_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include <cstddef>
+#include <string_view>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API CommandLine
+    /// An NNTP command line, built in a fixed buffer.
+    ///
+    /// The verbs come from a table fixed at compile time and numbers
+    /// are written with std::to_chars, so encoding e.g. "STAT 3000234"
+    /// or "OVER 1-500" touches no heap memory. The line always ends
+    /// in CRLF and is sent as it stands.
+    ///
+    /// RFC 3977 limits command lines to 512 octets, CRLF included;
+    /// arguments that would exceed that throw a NNTPException.
+{
+public:
+    enum Verb
+    {
+        ARTICLE,
+        AUTHINFO_PASS,
+        AUTHINFO_SASL,
+        AUTHINFO_USER,
+        BODY,
+        CAPABILITIES,
+        CHECK,
+        DATE,
+        GROUP,
+        HEAD,
+        LIST,
+        LIST_ACTIVE,
+        LIST_NEWSGROUPS,
+        LISTGROUP,
+        MODE_STREAM,
+        NEWGROUPS,
+        OVER,
+        POST,
+        QUIT,
+        STAT,
+        TAKETHIS,
+        VERBS
+    };
+
+    enum
+    {
+        MAX_LENGTH = 512 // including CRLF
+    };
+
+    explicit CommandLine(Verb verb);
+
+    CommandLine& arg(std::string_view argument);
+        /// Appends a space and the argument, unless it is empty.
+
+    CommandLine& arg(uint_t number);
+        /// Appends a space and the number in decimal.
+
+    CommandLine& range(uint_t low, uint_t high);
+        /// Appends a space and "low-high".
+
+    std::string_view line() const;
+        /// Returns the command line including its CRLF.
+
+    static std::string_view verb(Verb verb);
+        /// Returns the command text of the given verb.
+
+private:
+    void append(const char* data, std::size_t size);
+    void append(uint_t number);
+    void terminate();
+
+    char m_buffer[MAX_LENGTH];
+    std::size_t m_size;
+};
+
+
+//
+// inlines
+//
+inline std::string_view CommandLine::line() const
+{
+    return std::string_view(m_buffer, m_size + 2);
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_CommandLine_INCLUDED
@@ -0,0 +1,103 @@
+//
+// CommandWriter.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  CommandWriter
+//
+
+
+#include "CommandWriter.h"
+#include "NNTPClientSession.h"
+
+#include <cstring>
+
+
+namespace Poco {
+namespace Net {
+
+
+CommandWriter::CommandWriter(StreamSocket& socket, std::size_t bufferSize):
+    m_socket(socket)
+{
+    m_buffer.resize(bufferSize);
+}
+
+
+CommandWriter::~CommandWriter()
+{
+}
+
+
+void CommandWriter::write(std::string_view data)
+{
+    if (data.empty())
+        return;
+    if (data.size() > m_buffer.size())
+    {
+        reference(data);
+        flush();
+        return;
+    }
+    if (data.size() > m_buffer.size() - m_used)
+        flush();
+
+    std::memcpy(m_buffer.data() + m_used, data.data(), data.size());
+    if (!m_segments.empty() && !m_segments.back().data && m_segments.back().offset + m_segments.back().size == m_used)
+        m_segments.back().size += data.size();
+    else
+        m_segments.push_back(Segment{nullptr, m_used, data.size()});
+    m_used += data.size();
+}
+
+
+void CommandWriter::reference(std::string_view data)
+{
+    if (!data.empty())
+        m_segments.push_back(Segment{data.data(), 0, data.size()});
+}
+
+
+void CommandWriter::flush()
+{
+    // a write may stop anywhere, so track the segment and the bytes of it already sent
+    std::size_t index = 0;
+    std::size_t skip = 0;
+    while (index < m_segments.size())
+    {
+        m_buffers.clear();
+        for (std::size_t i = index; i < m_segments.size() && m_buffers.size() < MAX_SEGMENTS; ++i)
+        {
+            const Segment& segment = m_segments[i];
+            const char* data = segment.data ? segment.data : m_buffer.data() + segment.offset;
+            const std::size_t offset = i == index ? skip : 0;
+            m_buffers.push_back(Socket::makeBuffer(const_cast<char*>(data + offset), segment.size - offset));
+        }
+        std::size_t sent = send(m_buffers);
+        while (sent > 0)
+        {
+            const std::size_t left = m_segments[index].size - skip;
+            if (sent < left)
+            {
+                skip += sent;
+                break;
+            }
+            sent -= left;
+            skip = 0;
+            ++index;
+        }
+    }
+    clear();
+}
+
+
+std::size_t CommandWriter::send(const SocketBufVec& buffers)
+{
+    int sent = m_socket.sendBytes(buffers);
+    if (sent <= 0)
+        throw ConnectionResetException("Connection closed while sending commands");
+    return static_cast<std::size_t>(sent);
+}
+
+
+} } // namespace Poco::Net
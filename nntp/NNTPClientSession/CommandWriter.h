@@ -0,0 +1,106 @@
+//
+// CommandWriter.h
+//
+// Library: Net
+// Package: Mail
+// Module:  CommandWriter
+//
+// Definition of the CommandWriter class.
+//
+
+
+#ifndef Net_CommandWriter_INCLUDED
+#define Net_CommandWriter_INCLUDED
+
+
+#include "Poco/Net/StreamSocket.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class CommandWriter
+    /// Collects outgoing commands for NNTPClientSession and sends
+    /// them together.
+    ///
+    /// Command lines are copied into a buffer of fixed size; large
+    /// payloads such as article text may instead be referenced where
+    /// they lie. flush() hands all of it to the socket in a single
+    /// vectored write (writev()), so a pipeline of thousands of small
+    /// commands costs a few system calls and TCP segments instead of
+    /// one of each per command.
+    ///
+    /// Nothing is sent until flush() is called, or until the buffer
+    /// is full; the session flushes before it waits for a response.
+{
+public:
+    CommandWriter(StreamSocket& socket, std::size_t bufferSize);
+    ~CommandWriter();
+
+    void write(std::string_view data);
+        /// Copies data into the buffer, flushing first if it does
+        /// not fit. Data larger than the buffer is sent at once.
+
+    void reference(std::string_view data);
+        /// Queues data without copying it; it must remain valid and
+        /// unchanged until the next flush().
+
+    void flush();
+        /// Sends everything queued, in order.
+
+    bool empty() const;
+        /// Returns true if nothing is queued.
+
+    void clear();
+        /// Discards everything queued, e.g. when the connection
+        /// is dropped.
+
+private:
+    enum
+    {
+        MAX_SEGMENTS = 512 // per writev(), below any IOV_MAX
+    };
+
+    struct Segment
+    {
+        const char* data;    // or nullptr for bytes in the buffer
+        std::size_t offset;  // into the buffer
+        std::size_t size;
+    };
+
+    CommandWriter(const CommandWriter&) = delete;
+    CommandWriter& operator=(const CommandWriter&) = delete;
+
+    std::size_t send(const SocketBufVec& buffers);
+
+    StreamSocket& m_socket;
+    std::vector<char> m_buffer;
+    std::size_t m_used{};
+    std::vector<Segment> m_segments;
+    SocketBufVec m_buffers;
+};
+
+
+//
+// inlines
+//
+inline bool CommandWriter::empty() const
+{
+    return m_segments.empty();
+}
+
+
+inline void CommandWriter::clear()
+{
+    m_used = 0;
+    m_segments.clear();
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_CommandWriter_INCLUDED
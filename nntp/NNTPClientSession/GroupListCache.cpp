@@ -0,0 +1,173 @@
+//
+// GroupListCache.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  GroupListCache
+//
+
+
+#include "GroupListCache.h"
+#include "Wildmat.h"
+
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+#include "Poco/Path.h"
+#include "Poco/TemporaryFile.h"
+
+#include <cstring>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const char CACHE_MAGIC[8] = {'N', 'N', 'T', 'P', 'G', 'L', 'C', '1'};
+
+const Poco::Timespan::TimeDiff DEFAULT_RECONCILE_INTERVAL = 7*Poco::Timespan::DAYS;
+
+} // namespace
+
+
+GroupListCache::GroupListCache(const std::string& path, const std::string& wildMat):
+    m_path(path),
+    m_wildMat(wildMat),
+    m_lastSync(0),
+    m_lastReconcile(0),
+    m_reconcileInterval(DEFAULT_RECONCILE_INTERVAL)
+{
+}
+
+
+GroupListCache::~GroupListCache()
+{
+}
+
+
+bool GroupListCache::load()
+{
+    m_loaded = false;
+    if (!Poco::File(m_path).exists())
+        return false;
+
+    try
+    {
+        Poco::FileInputStream in(m_path, std::ios::in | std::ios::binary);
+        char magic[sizeof(CACHE_MAGIC)];
+        Poco::Int64 times[2];
+        Poco::UInt64 wildMatLength = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(times), sizeof(times));
+        in.read(reinterpret_cast<char*>(&wildMatLength), sizeof(wildMatLength));
+        if (!in || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || wildMatLength != m_wildMat.size())
+            return false;
+
+        std::string wildMat(static_cast<std::size_t>(wildMatLength), '\0');
+        in.read(&wildMat[0], static_cast<std::streamsize>(wildMat.size()));
+        if (!in || wildMat != m_wildMat)
+            return false;
+
+        m_groups.load(in);
+        m_lastSync = Poco::Timestamp(times[0]);
+        m_lastReconcile = Poco::Timestamp(times[1]);
+        m_loaded = true;
+    }
+    catch (const Poco::DataFormatException&)
+    {
+        m_groups.clear();
+    }
+    catch (const Poco::FileException&)
+    {
+        m_groups.clear();
+    }
+    return m_loaded;
+}
+
+
+void GroupListCache::save() const
+{
+    Poco::Path path(m_path);
+    Poco::File(path.parent()).createDirectories();
+
+    // replace the cache atomically so a crash never leaves half a list
+    const std::string tempPath = Poco::TemporaryFile::tempName(path.parent().toString());
+    {
+        Poco::FileOutputStream out(tempPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        const Poco::Int64 times[2] = {m_lastSync.epochMicroseconds(), m_lastReconcile.epochMicroseconds()};
+        const Poco::UInt64 wildMatLength = m_wildMat.size();
+        out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        out.write(reinterpret_cast<const char*>(times), sizeof(times));
+        out.write(reinterpret_cast<const char*>(&wildMatLength), sizeof(wildMatLength));
+        out.write(m_wildMat.data(), static_cast<std::streamsize>(m_wildMat.size()));
+        m_groups.save(out);
+        if (!out)
+            throw Poco::WriteFileException(tempPath);
+    }
+    Poco::File(tempPath).renameTo(m_path);
+}
+
+
+void GroupListCache::refresh(NNTPClientSession& session)
+{
+    if (!m_loaded || isReconcileDue())
+    {
+        reconcile(session);
+        return;
+    }
+
+    // take the server's time before asking, so that groups created
+    // while the listing is in progress are picked up next time
+    const Poco::Timestamp now = session.date();
+    GroupTable created;
+    session.newGroups(m_lastSync, created);
+    const Wildmat wildMat(m_wildMat);
+    bool changed = false;
+    for (std::size_t i = 0; i < created.size(); ++i)
+    {
+        if (!wildMat.match(created.name(i)))
+            continue;
+
+        // NEWGROUPS carries no descriptions; fetch them for the few new groups
+        session.listNewsGroups(std::string(created.name(i)), m_groups);
+        session.listActive(std::string(created.name(i)), m_groups);
+        changed = true;
+    }
+    m_lastSync = now;
+    if (changed)
+        m_groups.sort();
+    save();
+}
+
+
+void GroupListCache::reconcile(NNTPClientSession& session)
+{
+    const Poco::Timestamp now = session.date();
+    GroupTable groups;
+    session.listNewsGroups(m_wildMat, groups);
+    session.listActive(m_wildMat, groups);
+    groups.sort();
+    m_groups.swap(groups);
+    m_lastSync = now;
+    m_lastReconcile = now;
+    m_loaded = true;
+    save();
+}
+
+
+void GroupListCache::setReconcileInterval(const Poco::Timespan& interval)
+{
+    m_reconcileInterval = interval;
+}
+
+
+bool GroupListCache::isReconcileDue() const
+{
+    return m_lastReconcile.isElapsed(m_reconcileInterval.totalMicroseconds());
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,117 @@
+//
+// GroupListCache.h
+//
+// Library: Net
+// Package: Mail
+// Module:  GroupListCache
+//
+// Definition of the GroupListCache class.
+//
+
+
+#ifndef Net_GroupListCache_INCLUDED
+#define Net_GroupListCache_INCLUDED
+
+
+#include "GroupTable.h"
+#include "NNTPClientSession.h"
+
+#include "Poco/Timespan.h"
+#include "Poco/Timestamp.h"
+
+#include <string>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API GroupListCache
+    /// A locally persisted list of the newsgroups matching a wildmat.
+    ///
+    /// The list is stored together with the server time of the last
+    /// synchronization. refresh() asks only for the groups created
+    /// since then (NEWGROUPS), which is a single short round trip;
+    /// a full LIST NEWSGROUPS / LIST ACTIVE reconcile, which also
+    /// drops removed groups, is done when no list is cached yet or
+    /// the reconcile interval has passed.
+{
+public:
+    GroupListCache(const std::string& path, const std::string& wildMat);
+        /// Creates a cache of the groups matching wildMat,
+        /// stored in the file at the given path.
+
+    ~GroupListCache();
+
+    bool load();
+        /// Loads the cached list. Returns false if there is no
+        /// usable cache for this wildmat.
+
+    void save() const;
+        /// Writes the list to the cache file.
+
+    void refresh(NNTPClientSession& session);
+        /// Brings the list up to date, incrementally if possible,
+        /// and saves it together with the new synchronization time.
+
+    void reconcile(NNTPClientSession& session);
+        /// Replaces the list with a full listing from the server.
+
+    void setReconcileInterval(const Poco::Timespan& interval);
+        /// Sets how often refresh() does a full reconcile.
+
+    bool isReconcileDue() const;
+
+    const GroupTable& groups() const;
+    GroupTable& groups();
+
+    const std::string& wildMat() const;
+    Poco::Timestamp lastSync() const;
+    Poco::Timestamp lastReconcile() const;
+
+private:
+    std::string m_path;
+    std::string m_wildMat;
+    GroupTable m_groups;
+    Poco::Timestamp m_lastSync;
+    Poco::Timestamp m_lastReconcile;
+    Poco::Timespan m_reconcileInterval;
+    bool m_loaded{};
+};
+
+
+//
+// inlines
+//
+inline const GroupTable& GroupListCache::groups() const
+{
+    return m_groups;
+}
+
+
+inline GroupTable& GroupListCache::groups()
+{
+    return m_groups;
+}
+
+
+inline const std::string& GroupListCache::wildMat() const
+{
+    return m_wildMat;
+}
+
+
+inline Poco::Timestamp GroupListCache::lastSync() const
+{
+    return m_lastSync;
+}
+
+
+inline Poco::Timestamp GroupListCache::lastReconcile() const
+{
+    return m_lastReconcile;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_GroupListCache_INCLUDED
@@ -0,0 +1,247 @@
+//
+// GroupTable.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  GroupTable
+//
+
+
+#include "GroupTable.h"
+
+#include "Poco/Exception.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <utility>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const char TABLE_MAGIC[8] = {'N', 'N', 'T', 'P', 'G', 'R', 'P', '1'};
+
+
+bool remaining(std::istream& in, Poco::UInt64& bytes)
+    /// Stores the number of bytes left in a seekable stream.
+{
+    const std::istream::pos_type here = in.tellg();
+    if (here == std::istream::pos_type(-1))
+        return false;
+    in.seekg(0, std::ios::end);
+    const std::istream::pos_type end = in.tellg();
+    in.seekg(here);
+    if (!in || end == std::istream::pos_type(-1))
+    {
+        in.clear();
+        in.seekg(here);
+        return false;
+    }
+    bytes = static_cast<Poco::UInt64>(end - here);
+    return true;
+}
+
+} // namespace
+
+
+GroupTable::GroupTable()
+{
+}
+
+
+GroupTable::~GroupTable()
+{
+}
+
+
+void GroupTable::reserve(std::size_t groups, std::size_t bytes)
+{
+    m_entries.reserve(groups);
+    m_arena.reserve(bytes);
+}
+
+
+void GroupTable::clear()
+{
+    m_entries.clear();
+    m_arena.clear();
+    m_sorted = true;
+}
+
+
+void GroupTable::swap(GroupTable& other)
+{
+    m_entries.swap(other.m_entries);
+    m_arena.swap(other.m_arena);
+    std::swap(m_sorted, other.m_sorted);
+}
+
+
+std::size_t GroupTable::add(std::string_view name, std::string_view description)
+{
+    Entry entry{};
+    entry.name = append(name);
+    entry.nameLength = static_cast<Poco::UInt32>(name.size());
+    entry.description = append(description);
+    entry.descriptionLength = static_cast<Poco::UInt32>(description.size());
+    if (m_sorted && !m_entries.empty() && this->name(m_entries.size() - 1) > name)
+        m_sorted = false;
+    m_entries.push_back(entry);
+    return m_entries.size() - 1;
+}
+
+
+void GroupTable::setDescription(std::size_t index, std::string_view description)
+{
+    // the old text stays in the arena; descriptions rarely change
+    m_entries[index].description = append(description);
+    m_entries[index].descriptionLength = static_cast<Poco::UInt32>(description.size());
+}
+
+
+void GroupTable::setActive(std::size_t index, uint_t low, uint_t high, char status)
+{
+    m_entries[index].low = low;
+    m_entries[index].high = high;
+    m_entries[index].status = static_cast<unsigned char>(status);
+}
+
+
+void GroupTable::merge(const GroupTable& other)
+{
+    if (empty())
+    {
+        m_entries = other.m_entries;
+        m_arena = other.m_arena;
+        m_sorted = other.m_sorted;
+        return;
+    }
+
+    // new groups are appended behind the known ones, which stay sorted
+    sort();
+    const std::size_t known = size();
+    for (std::size_t i = 0; i < other.size(); ++i)
+    {
+        std::size_t index = lookup(other.name(i), known);
+        if (index == NOT_FOUND)
+        {
+            index = add(other.name(i), other.description(i));
+        }
+        else if (!other.description(i).empty() && description(index) != other.description(i))
+        {
+            setDescription(index, other.description(i));
+        }
+        if (other.status(i) != '\0')
+            setActive(index, other.lowArticle(i), other.highArticle(i), other.status(i));
+    }
+}
+
+
+void GroupTable::sort()
+{
+    if (m_sorted)
+        return;
+
+    std::sort(m_entries.begin(), m_entries.end(), [this](const Entry& lhs, const Entry& rhs)
+        { return text(lhs.name, lhs.nameLength) < text(rhs.name, rhs.nameLength); });
+    m_sorted = true;
+}
+
+
+std::size_t GroupTable::find(std::string_view name)
+{
+    sort();
+    return lookup(name, size());
+}
+
+
+std::pair<std::size_t, std::size_t> GroupTable::prefix(std::string_view prefix)
+{
+    sort();
+    auto first = std::lower_bound(m_entries.begin(), m_entries.end(), prefix, [this](const Entry& entry, std::string_view key)
+        { return text(entry.name, entry.nameLength) < key; });
+    auto last = std::partition_point(first, m_entries.end(), [this, prefix](const Entry& entry)
+        { return text(entry.name, entry.nameLength).substr(0, prefix.size()) == prefix; });
+    return {static_cast<std::size_t>(first - m_entries.begin()), static_cast<std::size_t>(last - m_entries.begin())};
+}
+
+
+std::size_t GroupTable::maxNameLength() const
+{
+    std::size_t length = 0;
+    for (const Entry& entry : m_entries)
+        length = std::max<std::size_t>(length, entry.nameLength);
+    return length;
+}
+
+
+void GroupTable::save(std::ostream& out) const
+{
+    // native byte order; the file is a local cache, not an exchange format
+    const Poco::UInt64 header[3] = {m_entries.size(), m_arena.size(), m_sorted ? 1U : 0U};
+    out.write(TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(m_entries.data()), static_cast<std::streamsize>(m_entries.size()*sizeof(Entry)));
+    out.write(m_arena.data(), static_cast<std::streamsize>(m_arena.size()));
+}
+
+
+void GroupTable::load(std::istream& in)
+{
+    char magic[sizeof(TABLE_MAGIC)];
+    Poco::UInt64 header[3];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || std::memcmp(magic, TABLE_MAGIC, sizeof(magic)) != 0)
+        throw Poco::DataFormatException("Not a group table");
+
+    // a corrupt header must not make us allocate more than the file holds
+    Poco::UInt64 available;
+    if (remaining(in, available) &&
+        (header[0] > available/sizeof(Entry) || header[1] > available - header[0]*sizeof(Entry)))
+        throw Poco::DataFormatException("Truncated group table");
+
+    std::vector<Entry> entries(static_cast<std::size_t>(header[0]));
+    std::vector<char> arena(static_cast<std::size_t>(header[1]));
+    in.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size()*sizeof(Entry)));
+    in.read(arena.data(), static_cast<std::streamsize>(arena.size()));
+    if (!in)
+        throw Poco::DataFormatException("Truncated group table");
+    for (const Entry& entry : entries)
+    {
+        if (Poco::UInt64(entry.name) + entry.nameLength > arena.size() ||
+            Poco::UInt64(entry.description) + entry.descriptionLength > arena.size())
+            throw Poco::DataFormatException("Corrupt group table");
+    }
+
+    m_entries.swap(entries);
+    m_arena.swap(arena);
+    m_sorted = header[2] != 0;
+}
+
+
+std::size_t GroupTable::lookup(std::string_view name, std::size_t count) const
+{
+    auto end = m_entries.begin() + static_cast<std::ptrdiff_t>(count);
+    auto it = std::lower_bound(m_entries.begin(), end, name, [this](const Entry& entry, std::string_view key)
+        { return text(entry.name, entry.nameLength) < key; });
+    if (it == end || text(it->name, it->nameLength) != name)
+        return NOT_FOUND;
+    return static_cast<std::size_t>(it - m_entries.begin());
+}
+
+
+Poco::UInt32 GroupTable::append(std::string_view text)
+{
+    const Poco::UInt32 offset = static_cast<Poco::UInt32>(m_arena.size());
+    m_arena.insert(m_arena.end(), text.begin(), text.end());
+    return offset;
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,177 @@
+//
+// GroupTable.h
+//
+// Library: Net
+// Package: Mail
+// Module:  GroupTable
+//
+// Definition of the GroupTable class.
+//
+
+
+#ifndef Net_GroupTable_INCLUDED
+#define Net_GroupTable_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API GroupTable
+    /// A compact table of newsgroups as returned by LIST NEWSGROUPS
+    /// and LIST ACTIVE.
+    ///
+    /// All names and descriptions live in one contiguous character
+    /// arena; each group is a fixed-size entry holding offsets into
+    /// the arena plus the active data. A list of hundreds of thousands
+    /// of groups therefore costs two allocations instead of one or two
+    /// per group, and can be saved and loaded in a single pass.
+    ///
+    /// Groups are addressed by index. Lookups by name and prefix keep
+    /// the entries sorted by name; adding groups invalidates the order,
+    /// which is restored by the next lookup or by sort().
+{
+public:
+    static constexpr std::size_t NOT_FOUND = ~std::size_t(0);
+
+    GroupTable();
+    ~GroupTable();
+
+    void reserve(std::size_t groups, std::size_t bytes);
+        /// Reserves room for the given number of groups and
+        /// characters of names and descriptions.
+
+    void clear();
+
+    void swap(GroupTable& other);
+
+    std::size_t add(std::string_view name, std::string_view description = std::string_view());
+        /// Appends a group and returns its index.
+
+    void setDescription(std::size_t index, std::string_view description);
+
+    void setActive(std::size_t index, uint_t low, uint_t high, char status);
+        /// Sets the article range and posting status (y, n, m, ...)
+        /// of the group at the given index.
+
+    std::size_t size() const;
+    bool empty() const;
+
+    std::string_view name(std::size_t index) const;
+    std::string_view description(std::size_t index) const;
+    uint_t lowArticle(std::size_t index) const;
+    uint_t highArticle(std::size_t index) const;
+    char status(std::size_t index) const;
+        /// Returns the posting status, or '\0' if the group
+        /// has no active data.
+
+    void merge(const GroupTable& other);
+        /// Adds the groups of the other table. Groups already
+        /// present take over non-empty descriptions and active
+        /// data from the other table.
+
+    void sort();
+        /// Sorts the groups by name.
+
+    std::size_t find(std::string_view name);
+        /// Returns the index of the named group, or NOT_FOUND.
+
+    std::pair<std::size_t, std::size_t> prefix(std::string_view prefix);
+        /// Returns the half-open index range of groups whose
+        /// names start with the given prefix.
+
+    std::size_t maxNameLength() const;
+
+    void save(std::ostream& out) const;
+        /// Writes the table in binary form.
+
+    void load(std::istream& in);
+        /// Replaces the table by one written with save().
+        ///
+        /// Throws a DataFormatException if the data is not a table.
+
+private:
+    struct Entry
+    {
+        Poco::UInt32 name;
+        Poco::UInt32 nameLength;
+        Poco::UInt32 description;
+        Poco::UInt32 descriptionLength;
+        Poco::UInt32 low;
+        Poco::UInt32 high;
+        Poco::UInt32 status;
+    };
+
+    std::size_t lookup(std::string_view name, std::size_t count) const;
+    Poco::UInt32 append(std::string_view text);
+    std::string_view text(Poco::UInt32 offset, Poco::UInt32 length) const;
+
+    std::vector<char> m_arena;
+    std::vector<Entry> m_entries;
+    bool m_sorted{true};
+};
+
+
+//
+// inlines
+//
+inline std::size_t GroupTable::size() const
+{
+    return m_entries.size();
+}
+
+
+inline bool GroupTable::empty() const
+{
+    return m_entries.empty();
+}
+
+
+inline std::string_view GroupTable::text(Poco::UInt32 offset, Poco::UInt32 length) const
+{
+    return std::string_view(m_arena.data() + offset, length);
+}
+
+
+inline std::string_view GroupTable::name(std::size_t index) const
+{
+    return text(m_entries[index].name, m_entries[index].nameLength);
+}
+
+
+inline std::string_view GroupTable::description(std::size_t index) const
+{
+    return text(m_entries[index].description, m_entries[index].descriptionLength);
+}
+
+
+inline uint_t GroupTable::lowArticle(std::size_t index) const
+{
+    return m_entries[index].low;
+}
+
+
+inline uint_t GroupTable::highArticle(std::size_t index) const
+{
+    return m_entries[index].high;
+}
+
+
+inline char GroupTable::status(std::size_t index) const
+{
+    return static_cast<char>(m_entries[index].status);
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_GroupTable_INCLUDED
@@ -0,0 +1,237 @@
+//
+// MessageDate.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  MessageDate
+//
+
+
+#include "MessageDate.h"
+
+#include "Poco/DateTime.h"
+#include "Poco/DateTimeParser.h"
+
+#include <string>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+inline bool isDigit(char c)
+{
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline bool isAlpha(char c)
+{
+    return static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+}
+
+inline void skipSpace(const char*& p, const char* end)
+{
+    while (p != end && (*p == ' ' || *p == '\t'))
+        ++p;
+}
+
+inline int digits(const char*& p, const char* end, int maxDigits, int& count)
+{
+    int value = 0;
+    for (count = 0; p != end && count < maxDigits && isDigit(*p); ++count, ++p)
+        value = value*10 + (*p - '0');
+    return value;
+}
+
+int month(const char* p)
+    // returns 1..12 for a three-letter month name in any case, or 0
+{
+    const unsigned key = (unsigned(p[0] | 0x20) << 16) | (unsigned(p[1] | 0x20) << 8) | unsigned(p[2] | 0x20);
+    switch (key)
+    {
+    case ('j' << 16) | ('a' << 8) | 'n': return 1;
+    case ('f' << 16) | ('e' << 8) | 'b': return 2;
+    case ('m' << 16) | ('a' << 8) | 'r': return 3;
+    case ('a' << 16) | ('p' << 8) | 'r': return 4;
+    case ('m' << 16) | ('a' << 8) | 'y': return 5;
+    case ('j' << 16) | ('u' << 8) | 'n': return 6;
+    case ('j' << 16) | ('u' << 8) | 'l': return 7;
+    case ('a' << 16) | ('u' << 8) | 'g': return 8;
+    case ('s' << 16) | ('e' << 8) | 'p': return 9;
+    case ('o' << 16) | ('c' << 8) | 't': return 10;
+    case ('n' << 16) | ('o' << 8) | 'v': return 11;
+    case ('d' << 16) | ('e' << 8) | 'c': return 12;
+    default: return 0;
+    }
+}
+
+bool zoneOffset(std::string_view name, int& minutes)
+    // the zone names of RFC 822; military letters carry no reliable offset
+{
+    static const struct
+    {
+        const char* name;
+        int minutes;
+    } ZONES[] =
+    {
+        {"GMT", 0}, {"UT", 0}, {"UTC", 0}, {"Z", 0},
+        {"EST", -5*60}, {"EDT", -4*60},
+        {"CST", -6*60}, {"CDT", -5*60},
+        {"MST", -7*60}, {"MDT", -6*60},
+        {"PST", -8*60}, {"PDT", -7*60}
+    };
+    for (const auto& zone : ZONES)
+    {
+        std::string_view zoneName(zone.name);
+        if (zoneName.size() != name.size())
+            continue;
+        bool equal = true;
+        for (std::size_t i = 0; equal && i < name.size(); ++i)
+            equal = (name[i] & ~0x20) == zoneName[i];
+        if (equal)
+        {
+            minutes = zone.minutes;
+            return true;
+        }
+    }
+    minutes = 0;
+    return name.size() == 1;
+}
+
+Poco::Int64 daysFromCivil(int year, int month, int day)
+    // days since 1970-01-01 in the proleptic Gregorian calendar
+{
+    year -= month <= 2;
+    const Poco::Int64 era = (year >= 0 ? year : year - 399)/400;
+    const Poco::Int64 yearOfEra = year - era*400;
+    const Poco::Int64 dayOfYear = (153*(month + (month > 2 ? -3 : 9)) + 2)/5 + day - 1;
+    const Poco::Int64 dayOfEra = yearOfEra*365 + yearOfEra/4 - yearOfEra/100 + dayOfYear;
+    return era*146097 + dayOfEra - 719468;
+}
+
+} // namespace
+
+
+bool MessageDate::parse(std::string_view text, Poco::Timestamp& timestamp)
+{
+    Poco::Timestamp::TimeVal time;
+    if (parseRFC5322(text, time))
+    {
+        timestamp = Poco::Timestamp(time);
+        return true;
+    }
+
+    Poco::DateTime dateTime;
+    int tzd = 0;
+    if (!Poco::DateTimeParser::tryParse(std::string(text), dateTime, tzd))
+        return false;
+    dateTime.makeUTC(tzd);
+    timestamp = dateTime.timestamp();
+    return true;
+}
+
+
+Poco::Timestamp::TimeVal MessageDate::parse(std::string_view text)
+{
+    Poco::Timestamp::TimeVal time;
+    if (parseRFC5322(text, time))
+        return time;
+
+    Poco::Timestamp timestamp;
+    return parse(text, timestamp) ? timestamp.epochMicroseconds() : 0;
+}
+
+
+bool MessageDate::parseRFC5322(std::string_view text, Poco::Timestamp::TimeVal& time)
+{
+    const char* p = text.data();
+    const char* const end = p + text.size();
+    int count;
+
+    skipSpace(p, end);
+    if (p != end && isAlpha(*p))
+    {
+        // day of week, which is redundant
+        while (p != end && isAlpha(*p))
+            ++p;
+        if (p == end || *p != ',')
+            return false;
+        ++p;
+        skipSpace(p, end);
+    }
+
+    const int day = digits(p, end, 2, count);
+    if (count == 0 || day < 1 || day > 31)
+        return false;
+    skipSpace(p, end);
+    if (end - p < 4)
+        return false;
+    const int mon = month(p);
+    if (mon == 0)
+        return false;
+    p += 3;
+    skipSpace(p, end);
+
+    int year = digits(p, end, 4, count);
+    if (count < 2)
+        return false;
+    if (count == 2)
+        year += year < 50 ? 2000 : 1900;
+    else if (count == 3)
+        year += 1900;
+    skipSpace(p, end);
+
+    const int hour = digits(p, end, 2, count);
+    if (count == 0 || p == end || *p != ':')
+        return false;
+    ++p;
+    const int minute = digits(p, end, 2, count);
+    if (count != 2)
+        return false;
+    int second = 0;
+    if (p != end && *p == ':')
+    {
+        ++p;
+        second = digits(p, end, 2, count);
+        if (count != 2)
+            return false;
+    }
+    if (hour > 23 || minute > 59 || second > 60)
+        return false;
+    if (second == 60)
+        second = 59; // a leap second; the Timestamp cannot hold it
+    skipSpace(p, end);
+
+    int offset = 0;
+    if (p != end && (*p == '+' || *p == '-'))
+    {
+        const bool negative = *p++ == '-';
+        const int zone = digits(p, end, 4, count);
+        if (count != 4)
+            return false;
+        offset = (zone/100)*60 + zone%100;
+        if (negative)
+            offset = -offset;
+    }
+    else if (p != end && isAlpha(*p))
+    {
+        const char* name = p;
+        while (p != end && isAlpha(*p))
+            ++p;
+        if (!zoneOffset(std::string_view(name, static_cast<std::size_t>(p - name)), offset))
+            return false;
+    }
+    skipSpace(p, end);
+    if (p != end && *p != '(')
+        return false;
+
+    const Poco::Int64 seconds = daysFromCivil(year, mon, day)*86400 + hour*3600 + minute*60 + second - offset*60;
+    time = seconds*Poco::Timestamp::resolution();
+    return true;
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,56 @@
+//
+// MessageDate.h
+//
+// Library: Net
+// Package: Mail
+// Module:  MessageDate
+//
+// Definition of the MessageDate class.
+//
+
+
+#ifndef Net_MessageDate_INCLUDED
+#define Net_MessageDate_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include "Poco/Timestamp.h"
+
+#include <string_view>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API MessageDate
+    /// Parses the dates of Date headers and overview data.
+    ///
+    /// Nearly all of them have the RFC 5322 form
+    /// "[Day, ]D Mon YYYY HH:MM[:SS] zone", which is parsed
+    /// directly into a Timestamp without building a DateTime. The
+    /// zone may be numeric, one of the RFC 822 names or missing,
+    /// and a trailing comment such as "(UTC)" is ignored; two and
+    /// three digit years are taken as RFC 5322 says. Anything else,
+    /// e.g. asctime() dates written by old software, is handed to
+    /// Poco's DateTimeParser.
+{
+public:
+    static bool parse(std::string_view text, Poco::Timestamp& timestamp);
+        /// Parses the date and stores it as UTC in timestamp.
+        /// Returns false if the text is not a recognizable date.
+
+    static Poco::Timestamp::TimeVal parse(std::string_view text);
+        /// Returns the date in microseconds since the epoch, or 0
+        /// if the text is not a recognizable date.
+
+private:
+    static bool parseRFC5322(std::string_view text, Poco::Timestamp::TimeVal& time);
+
+    MessageDate() = delete;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_MessageDate_INCLUDED
@@ -0,0 +1,396 @@
+//
+// MessageIdHistory.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  MessageIdHistory
+//
+
+
+#include "MessageIdHistory.h"
+
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const char INDEX_MAGIC[8] = {'N', 'N', 'T', 'P', 'H', 'I', 'X', '1'};
+
+// magic, capacity, count, log size
+const std::streamoff INDEX_HEADER_SIZE = sizeof(INDEX_MAGIC) + 3*sizeof(Poco::UInt64);
+
+const std::size_t MIN_CAPACITY = 1024;
+
+Poco::UInt64 slotHash(const std::string& messageId)
+{
+    // 0 marks an empty slot
+    Poco::UInt64 hash = BloomFilter::hash(messageId);
+    return hash != 0 ? hash : 1;
+}
+
+Poco::UInt64 roundUpPowerOfTwo(Poco::UInt64 value)
+{
+    Poco::UInt64 result = MIN_CAPACITY;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+void createFile(const std::string& path)
+{
+    std::ofstream create(path, std::ios::out | std::ios::binary | std::ios::app);
+    if (!create)
+        throw Poco::CreateFileException(path);
+}
+
+void openFile(std::fstream& file, const std::string& path)
+{
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file)
+        throw Poco::OpenFileException(path);
+}
+
+} // namespace
+
+
+MessageIdHistory::MessageIdHistory(const std::string& basePath, std::size_t expectedItems, double falsePositiveRate):
+    m_logPath(basePath + ".log"),
+    m_indexPath(basePath + ".index"),
+    m_bloomPath(basePath + ".bloom"),
+    m_filter(expectedItems, falsePositiveRate)
+{
+    openLog();
+    openIndex(static_cast<std::size_t>(roundUpPowerOfTwo(static_cast<Poco::UInt64>(expectedItems)*2)));
+
+    bool filterCurrent = false;
+    if (Poco::File(m_bloomPath).exists())
+    {
+        std::ifstream in(m_bloomPath, std::ios::in | std::ios::binary);
+        Poco::UInt64 count = 0;
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (in && count == m_count)
+        {
+            try
+            {
+                m_filter.load(in);
+                filterCurrent = true;
+            }
+            catch (const Poco::DataFormatException&)
+            {
+            }
+        }
+    }
+    if (!filterCurrent)
+        rebuildFilter();
+}
+
+
+MessageIdHistory::~MessageIdHistory()
+{
+    try
+    {
+        flush();
+    }
+    catch (...)
+    {
+    }
+}
+
+
+bool MessageIdHistory::contains(const std::string& messageId)
+{
+    const Poco::UInt64 hash = slotHash(messageId);
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    ++m_statistics.lookups;
+    if (!m_filter.mayContain(hash))
+    {
+        ++m_statistics.filterNegatives;
+        return false;
+    }
+    if (findExact(messageId, hash))
+        return true;
+
+    ++m_statistics.falsePositives;
+    return false;
+}
+
+
+bool MessageIdHistory::add(const std::string& messageId)
+{
+    const Poco::UInt64 hash = slotHash(messageId);
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    if (m_filter.mayContain(hash) && findExact(messageId, hash))
+        return false;
+
+    const Poco::UInt64 offset = m_logSize;
+    m_log.clear();
+    m_log.seekp(static_cast<std::streamoff>(offset));
+    m_log << messageId << '\n';
+    if (!m_log)
+        throw Poco::WriteFileException(m_logPath);
+    m_logSize += messageId.size() + 1;
+
+    insertSlot(m_index, m_capacity, Slot{hash, offset});
+    m_filter.add(hash);
+    ++m_count;
+
+    // keep the load factor below 0.7 so probe sequences stay short
+    if (m_count*10 > m_capacity*7)
+        grow();
+    return true;
+}
+
+
+std::size_t MessageIdHistory::size() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return static_cast<std::size_t>(m_count);
+}
+
+
+void MessageIdHistory::flush()
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    writeIndexHeader();
+    m_index.flush();
+
+    std::ofstream out(m_bloomPath, std::ios::out | std::ios::trunc | std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&m_count), sizeof(m_count));
+    m_filter.save(out);
+    if (!out)
+        throw Poco::WriteFileException(m_bloomPath);
+}
+
+
+MessageIdHistory::Statistics MessageIdHistory::statistics() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_statistics;
+}
+
+
+void MessageIdHistory::openLog()
+{
+    createFile(m_logPath);
+    openFile(m_log, m_logPath);
+    m_log.seekg(0, std::ios::end);
+    m_logSize = static_cast<Poco::UInt64>(m_log.tellg());
+}
+
+
+void MessageIdHistory::openIndex(std::size_t capacity)
+{
+    Poco::UInt64 indexedLogSize = 0;
+    if (Poco::File(m_indexPath).exists() && Poco::File(m_indexPath).getSize() >= static_cast<Poco::File::FileSize>(INDEX_HEADER_SIZE))
+    {
+        openFile(m_index, m_indexPath);
+        char magic[sizeof(INDEX_MAGIC)];
+        Poco::UInt64 header[3];
+        m_index.read(magic, sizeof(magic));
+        m_index.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!m_index || std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0)
+            throw Poco::DataFormatException("Not a history index", m_indexPath);
+        m_capacity = header[0];
+        m_count = header[1];
+        indexedLogSize = header[2];
+        if (indexedLogSize > m_logSize)
+        {
+            // the index refers to log entries lost in a crash; index the whole log anew
+            m_index.close();
+            indexedLogSize = 0;
+        }
+    }
+
+    // until the replay below is done, headers must not claim the entries it has yet to index
+    const Poco::UInt64 logSize = m_logSize;
+    m_logSize = indexedLogSize;
+
+    if (!m_index.is_open())
+    {
+        std::ofstream create(m_indexPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!create)
+            throw Poco::CreateFileException(m_indexPath);
+        create.close();
+        openFile(m_index, m_indexPath);
+        m_capacity = capacity;
+        m_count = 0;
+        writeIndexHeader();
+        // extend the file to its full size; unwritten slots read as empty
+        m_index.seekp(INDEX_HEADER_SIZE + static_cast<std::streamoff>(m_capacity*sizeof(Slot)) - 1);
+        m_index.put('\0');
+    }
+
+    // index entries that were logged after the last flush, e.g. before a crash
+    if (indexedLogSize < logSize)
+    {
+        m_log.clear();
+        m_log.seekg(static_cast<std::streamoff>(indexedLogSize));
+        std::vector<std::pair<std::string, Poco::UInt64>> pending;
+        std::string messageId;
+        Poco::UInt64 offset = indexedLogSize;
+        while (std::getline(m_log, messageId))
+        {
+            const Poco::UInt64 next = offset + messageId.size() + 1;
+            pending.emplace_back(std::move(messageId), offset);
+            offset = next;
+        }
+        m_log.clear();
+        for (const auto& entry : pending)
+        {
+            const Slot slot{slotHash(entry.first), entry.second};
+            if (!findExact(entry.first, slot.hash))
+            {
+                insertSlot(m_index, m_capacity, slot);
+                ++m_count;
+                if (m_count*10 > m_capacity*7)
+                    grow();
+            }
+            m_logSize = std::min(entry.second + entry.first.size() + 1, logSize);
+        }
+    }
+    m_logSize = logSize;
+}
+
+
+void MessageIdHistory::rebuildFilter()
+{
+    m_filter.clear();
+    m_log.clear();
+    m_log.seekg(0);
+    std::string messageId;
+    while (std::getline(m_log, messageId))
+        m_filter.add(slotHash(messageId));
+    m_log.clear();
+}
+
+
+bool MessageIdHistory::findExact(const std::string& messageId, Poco::UInt64 hash)
+{
+    const Poco::UInt64 mask = m_capacity - 1;
+    for (Poco::UInt64 i = hash & mask;; i = (i + 1) & mask)
+    {
+        Slot slot;
+        m_index.clear();
+        m_index.seekg(INDEX_HEADER_SIZE + static_cast<std::streamoff>(i*sizeof(Slot)));
+        m_index.read(reinterpret_cast<char*>(&slot), sizeof(slot));
+        if (!m_index)
+            throw Poco::ReadFileException(m_indexPath);
+        if (slot.hash == 0)
+            return false;
+        if (slot.hash == hash && readLogEntry(slot.offset) == messageId)
+            return true;
+    }
+}
+
+
+void MessageIdHistory::insertSlot(std::fstream& index, Poco::UInt64 capacity, const Slot& slot)
+{
+    const Poco::UInt64 mask = capacity - 1;
+    for (Poco::UInt64 i = slot.hash & mask;; i = (i + 1) & mask)
+    {
+        const std::streamoff position = INDEX_HEADER_SIZE + static_cast<std::streamoff>(i*sizeof(Slot));
+        Slot existing;
+        index.clear();
+        index.seekg(position);
+        index.read(reinterpret_cast<char*>(&existing), sizeof(existing));
+        if (!index)
+            throw Poco::ReadFileException(m_indexPath);
+        if (existing.hash == 0)
+        {
+            index.seekp(position);
+            index.write(reinterpret_cast<const char*>(&slot), sizeof(slot));
+            if (!index)
+                throw Poco::WriteFileException(m_indexPath);
+            return;
+        }
+    }
+}
+
+
+void MessageIdHistory::grow()
+{
+    const Poco::UInt64 capacity = m_capacity*2;
+    const std::string newPath = m_indexPath + ".new";
+    {
+        std::ofstream create(newPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!create)
+            throw Poco::CreateFileException(newPath);
+    }
+
+    std::fstream grown;
+    openFile(grown, newPath);
+    grown.seekp(INDEX_HEADER_SIZE + static_cast<std::streamoff>(capacity*sizeof(Slot)) - 1);
+    grown.put('\0');
+
+    // rehash the old table in large sequential chunks
+    std::vector<Slot> chunk(4096);
+    m_index.clear();
+    m_index.seekg(INDEX_HEADER_SIZE);
+    for (Poco::UInt64 done = 0; done < m_capacity;)
+    {
+        const std::size_t n = static_cast<std::size_t>(std::min<Poco::UInt64>(chunk.size(), m_capacity - done));
+        m_index.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(n*sizeof(Slot)));
+        if (!m_index)
+            throw Poco::ReadFileException(m_indexPath);
+        const std::streamoff resume = m_index.tellg();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (chunk[i].hash != 0)
+                insertSlot(grown, capacity, chunk[i]);
+        }
+        m_index.seekg(resume);
+        done += n;
+    }
+    grown.close();
+    m_index.close();
+
+    Poco::File(newPath).renameTo(m_indexPath);
+    openFile(m_index, m_indexPath);
+    m_capacity = capacity;
+    writeIndexHeader();
+}
+
+
+void MessageIdHistory::writeIndexHeader()
+{
+    // the header may reach the disk at any time after this, and must
+    // never claim more of the log than is there
+    m_log.flush();
+    if (!m_log)
+        throw Poco::WriteFileException(m_logPath);
+
+    // native byte order; the history is local state, not an exchange format
+    const Poco::UInt64 header[3] = {m_capacity, m_count, m_logSize};
+    m_index.clear();
+    m_index.seekp(0);
+    m_index.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    m_index.write(reinterpret_cast<const char*>(header), sizeof(header));
+    if (!m_index)
+        throw Poco::WriteFileException(m_indexPath);
+}
+
+
+std::string MessageIdHistory::readLogEntry(Poco::UInt64 offset)
+{
+    std::string messageId;
+    m_log.clear();
+    m_log.seekg(static_cast<std::streamoff>(offset));
+    std::getline(m_log, messageId);
+    if (!m_log)
+        throw Poco::ReadFileException(m_logPath);
+    return messageId;
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,110 @@
+//
+// MessageIdHistory.h
+//
+// Library: Net
+// Package: Mail
+// Module:  MessageIdHistory
+//
+// Definition of the MessageIdHistory class.
+//
+
+
+#ifndef Net_MessageIdHistory_INCLUDED
+#define Net_MessageIdHistory_INCLUDED
+
+
+#include "BloomFilter.h"
+#include "NNTPClientSession.h"
+
+#include "Poco/Mutex.h"
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API MessageIdHistory
+    /// A persistent record of message-ids that have been seen,
+    /// answering "have we seen this article?" for feeders,
+    /// mirroring tools and caches.
+    ///
+    /// Lookups first consult an in-memory Bloom filter, so the
+    /// common negative answer costs no disk access. Positive
+    /// filter answers are confirmed against an exact history made
+    /// of two files: an append-only log of message-ids and an
+    /// open-addressing hash index of (hash, log offset) slots.
+    ///
+    /// Given a base path, the history uses base.log, base.index
+    /// and base.bloom. The filter is written by flush() and on
+    /// destruction; if it is missing or stale it is rebuilt from
+    /// the log when the history is opened.
+    ///
+    /// All member functions are thread-safe.
+{
+public:
+    MessageIdHistory(const std::string& basePath, std::size_t expectedItems, double falsePositiveRate = 0.01);
+        /// Opens or creates the history at the given base path,
+        /// sizing the filter and the initial index for the expected
+        /// number of message-ids.
+
+    ~MessageIdHistory();
+        /// Flushes and closes the history.
+
+    bool contains(const std::string& messageId);
+        /// Returns true if the message-id has been added.
+
+    bool add(const std::string& messageId);
+        /// Records the message-id. Returns false if it was
+        /// already present.
+
+    std::size_t size() const;
+        /// Returns the number of recorded message-ids.
+
+    void flush();
+        /// Writes the filter and index header and flushes all files.
+
+    struct Statistics
+    {
+        std::size_t lookups{};
+        std::size_t filterNegatives{};
+        std::size_t falsePositives{};
+    };
+
+    Statistics statistics() const;
+
+private:
+    struct Slot
+    {
+        Poco::UInt64 hash;
+        Poco::UInt64 offset;
+    };
+
+    void openLog();
+    void openIndex(std::size_t capacity);
+    void rebuildFilter();
+    bool findExact(const std::string& messageId, Poco::UInt64 hash);
+    void insertSlot(std::fstream& index, Poco::UInt64 capacity, const Slot& slot);
+    void grow();
+    void writeIndexHeader();
+    std::string readLogEntry(Poco::UInt64 offset);
+
+    std::string m_logPath;
+    std::string m_indexPath;
+    std::string m_bloomPath;
+    BloomFilter m_filter;
+    std::fstream m_log;
+    std::fstream m_index;
+    Poco::UInt64 m_logSize{};
+    Poco::UInt64 m_capacity{};
+    Poco::UInt64 m_count{};
+    Statistics m_statistics;
+    mutable Poco::FastMutex m_mutex;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_MessageIdHistory_INCLUDED
@@ -0,0 +1,165 @@
+//
+// NNTPArticlePipeline.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPArticlePipeline
+//
+
+
+#include "NNTPArticlePipeline.h"
+
+#include "Poco/Net/MailMessage.h"
+#include "Poco/Environment.h"
+#include "Poco/MemoryStream.h"
+
+#include <algorithm>
+#include <utility>
+
+
+namespace Poco {
+namespace Net {
+
+
+NNTPArticlePipeline::NNTPArticlePipeline(std::size_t workers, std::size_t queueDepth):
+    m_queueDepth(std::max<std::size_t>(queueDepth, 1)),
+    m_window(NNTPClientSession::DEFAULT_PIPELINE_WINDOW)
+{
+    if (workers == 0)
+        workers = std::max(Poco::Environment::processorCount(), 1u);
+    for (std::size_t i = 0; i < workers; ++i)
+    {
+        m_threads.emplace_back(new Poco::Thread);
+        m_threads.back()->startFunc([this] { decode(); });
+    }
+}
+
+
+NNTPArticlePipeline::~NNTPArticlePipeline()
+{
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        m_stopping = true;
+        m_notEmpty.broadcast();
+    }
+    for (const std::unique_ptr<Poco::Thread>& thread : m_threads)
+        thread->join();
+}
+
+
+std::vector<std::string> NNTPArticlePipeline::fetch(NNTPClientSession& session, const std::vector<std::string>& requests, const Handler& handler)
+{
+    std::vector<std::string> missing;
+    try
+    {
+        session.articles(requests,
+            [&](std::size_t index, int status, std::string& text)
+            {
+                // no such article number (423) or message-id (430); an empty 220 is still an article
+                if (status == 423 || status == 430)
+                {
+                    missing.push_back(requests[index]);
+                    return;
+                }
+                // hand the framed text over and keep framing into a recycled buffer
+                Buffer framed = acquireBuffer();
+                framed->swap(text);
+                enqueue(Job{&requests[index], &handler, std::move(framed)});
+            },
+            m_window);
+    }
+    catch (...)
+    {
+        waitIdle();
+        throw;
+    }
+    waitIdle();
+
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    if (m_error)
+    {
+        std::exception_ptr error;
+        std::swap(error, m_error);
+        std::rethrow_exception(error);
+    }
+    return missing;
+}
+
+
+void NNTPArticlePipeline::enqueue(Job job)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    while (m_queue.size() >= m_queueDepth)
+        m_notFull.wait(m_mutex);
+    m_queue.push_back(std::move(job));
+    m_notEmpty.signal();
+}
+
+
+void NNTPArticlePipeline::decode()
+{
+    for (;;)
+    {
+        Job job;
+        bool skip;
+        {
+            Poco::FastMutex::ScopedLock lock(m_mutex);
+            while (m_queue.empty() && !m_stopping)
+                m_notEmpty.wait(m_mutex);
+            if (m_queue.empty())
+                return;
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+            ++m_busy;
+            skip = static_cast<bool>(m_error);
+            m_notFull.signal();
+        }
+
+        std::exception_ptr error;
+        if (!skip)
+        {
+            try
+            {
+                Poco::MemoryInputStream stream(job.text->data(), job.text->size());
+                NewsArticle article;
+                article.read(stream);
+                (*job.handler)(*job.request, article);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        }
+
+        job.text->clear();
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        if (error && !m_error)
+            m_error = error;
+        m_buffers.push_back(std::move(job.text));
+        if (--m_busy == 0 && m_queue.empty())
+            m_idle.broadcast();
+    }
+}
+
+
+NNTPArticlePipeline::Buffer NNTPArticlePipeline::acquireBuffer()
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    if (m_buffers.empty())
+        return Buffer(new std::string);
+
+    Buffer buffer = std::move(m_buffers.back());
+    m_buffers.pop_back();
+    return buffer;
+}
+
+
+void NNTPArticlePipeline::waitIdle()
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    while (m_busy != 0 || !m_queue.empty())
+        m_idle.wait(m_mutex);
+}
+
+
+} } // namespace Poco::Net
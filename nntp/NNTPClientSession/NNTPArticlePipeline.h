@@ -0,0 +1,144 @@
+//
+// NNTPArticlePipeline.h
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPArticlePipeline
+//
+// Definition of the NNTPArticlePipeline class.
+//
+
+
+#ifndef Net_NNTPArticlePipeline_INCLUDED
+#define Net_NNTPArticlePipeline_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Thread.h"
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API NNTPArticlePipeline
+    /// This class splits article retrieval into an I/O stage
+    /// and a decoding stage.
+    ///
+    /// The thread calling fetch() only drives the session: it
+    /// pipelines ARTICLE commands and frames each response into a
+    /// pooled buffer. Framed articles are passed through a bounded
+    /// queue to a fixed set of worker threads, which parse them
+    /// with MailMessage::read() and invoke the handler. Reading
+    /// therefore never waits for MIME decoding unless the queue is
+    /// full, and decoding is spread over several cores.
+    ///
+    /// Buffers are recycled between articles, so after warm-up no
+    /// allocation is needed for framing.
+{
+public:
+    using Handler = std::function<void(const std::string& request, NewsArticle& article)>;
+        /// Called on a worker thread for each retrieved article;
+        /// handlers for different articles run concurrently.
+
+    enum
+    {
+        DEFAULT_QUEUE_DEPTH = 64 // framed articles waiting for a worker
+    };
+
+    explicit NNTPArticlePipeline(std::size_t workers = 0, std::size_t queueDepth = DEFAULT_QUEUE_DEPTH);
+        /// Creates the pipeline and starts the given number of
+        /// decoding threads; zero uses one per processor.
+
+    ~NNTPArticlePipeline();
+        /// Stops the decoding threads.
+
+    std::vector<std::string> fetch(NNTPClientSession& session, const std::vector<std::string>& requests, const Handler& handler);
+        /// Retrieves and decodes the articles with the given numbers
+        /// or message-ids in the current group of the session, and
+        /// returns the requests the server does not have.
+        ///
+        /// Returns once every article has been handled. The first
+        /// exception thrown by a handler or parser is rethrown; the
+        /// remaining articles are still retrieved but not handled.
+        /// If the session fails, the exception is rethrown after the
+        /// queued articles have been handled, and the session should
+        /// be aborted.
+
+    void setWindow(std::size_t window);
+        /// Sets the number of ARTICLE commands kept outstanding.
+
+    std::size_t window() const;
+
+    std::size_t workers() const;
+
+private:
+    using Buffer = std::unique_ptr<std::string>;
+
+    struct Job
+    {
+        const std::string* request;
+        const Handler* handler;
+        Buffer text;
+    };
+
+    NNTPArticlePipeline(const NNTPArticlePipeline&) = delete;
+    NNTPArticlePipeline& operator=(const NNTPArticlePipeline&) = delete;
+
+    void enqueue(Job job);
+    void decode();
+        /// The worker thread loop.
+
+    Buffer acquireBuffer();
+    void waitIdle();
+
+    std::size_t m_queueDepth;
+    std::size_t m_window;
+    std::vector<std::unique_ptr<Poco::Thread>> m_threads;
+
+    Poco::FastMutex m_mutex;
+    Poco::Condition m_notEmpty;
+    Poco::Condition m_notFull;
+    Poco::Condition m_idle;
+    std::deque<Job> m_queue;
+    std::vector<Buffer> m_buffers;
+    std::size_t m_busy{};
+    std::exception_ptr m_error;
+    bool m_stopping{};
+};
+
+
+//
+// inlines
+//
+inline void NNTPArticlePipeline::setWindow(std::size_t window)
+{
+    m_window = window;
+}
+
+
+inline std::size_t NNTPArticlePipeline::window() const
+{
+    return m_window;
+}
+
+
+inline std::size_t NNTPArticlePipeline::workers() const
+{
+    return m_threads.size();
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_NNTPArticlePipeline_INCLUDED
@@ -8,20 +8,34 @@
 
 
 #include "NNTPClientSession.h"
+#include "ArticleSet.h"
+#include "CancellationToken.h"
+#include "CommandLine.h"
+#include "GroupTable.h"
+#include "OverviewBatch.h"
+#include "StatusLine.h"
 
 #include "Poco/Net/DialogSocket.h"
 #include "Poco/Net/MailMessage.h"
 #include "Poco/Net/MailStream.h"
 #include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/SocketDefs.h"
+#include "Poco/Net/SocketStream.h"
 #include "Poco/Net/NetException.h"
+#include "Poco/DateTime.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeParser.h"
 #include "Poco/Environment.h"
-#include "Poco/NumberParser.h"
 #include "Poco/StreamCopier.h"
 #include "Poco/Base64Encoder.h"
 #include "Poco/Base64Decoder.h"
 #include "Poco/String.h"
-#include "Poco/StringTokenizer.h"
+#include "Poco/Thread.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <sstream>
+#include <string_view>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -37,78 +51,90 @@ namespace Poco {
 namespace Net {
 
 
-class DialogStreamBuf: public Poco::UnbufferedStreamBuf
+namespace
 {
-public:
-	DialogStreamBuf(DialogSocket& socket):
-		_socket(socket)
-	{
-	}
-	
-	~DialogStreamBuf()
-	{
-	}
-		
-private:
-	int readFromDevice()
-	{
-		return _socket.get();
-	}
-	
-	DialogSocket& _socket;
-};
 
-
-class DialogIOS: public virtual std::ios
+void addActive(std::string_view text, GroupTable& groups)
 {
-public:
-	DialogIOS(DialogSocket& socket):
-		_buf(socket)
-	{
-		poco_ios_init(&_buf);
-	}
-	
-	~DialogIOS()
-	{
-	}
-	
-	DialogStreamBuf* rdbuf()
-	{
-		return &_buf;
-	}
+    // gmane.comp.lib.boost.user 91036 1 y
+    std::string_view fields[4];
+    std::size_t count = 0;
+    std::string::size_type begin = text.find_first_not_of(' ');
+    while (begin != std::string::npos && count < 4)
+    {
+        std::string::size_type end = text.find(' ', begin);
+        fields[count++] = text.substr(begin, end - begin);
+        begin = end == std::string::npos ? end : text.find_first_not_of(' ', end);
+    }
+    if (count < 4)
+        return;
+
+    uint_t high = 0;
+    uint_t low = 0;
+    std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), high);
+    std::from_chars(fields[2].data(), fields[2].data() + fields[2].size(), low);
+    groups.setActive(groups.add(fields[0]), low, high, fields[3][0]);
+}
 
-protected:
-	DialogStreamBuf _buf;
-};
+} // namespace
 
 
-class DialogInputStream: public DialogIOS, public std::istream
+template <typename Operation>
+auto NNTPClientSession::withReconnect(Operation operation)
 {
-public:
-	DialogInputStream(DialogSocket& socket):
-		DialogIOS(socket),
-		std::istream(&_buf)
-	{
-	}
-		
-	~DialogInputStream()
-	{
-	}
-};
+    return withReconnect(operation, []() { return std::size_t(0); });
+}
+
+
+template <typename Operation, typename Progress>
+auto NNTPClientSession::withReconnect(Operation operation, Progress progress)
+{
+    std::size_t done = progress();
+    for (int attempt = 1;;)
+    {
+        try
+        {
+            return operation();
+        }
+        catch (const Poco::Exception& exc)
+        {
+            // only failures in a row count against the limit
+            if (progress() != done)
+            {
+                done = progress();
+                attempt = 1;
+            }
+            if (!recover(exc, attempt))
+                throw;
+        }
+    }
+}
 
 
 NNTPClientSession::NNTPClientSession(const StreamSocket& socket):
+	m_address(socket.peerAddress()),
 	m_socket(socket),
-	m_isOpen(false)
+	m_isOpen(false),
+	m_reader(m_socket, RAW_BUFFER_SIZE),
+	m_writer(m_socket, WRITE_BUFFER_SIZE),
+	m_reconnectDelay(DEFAULT_RECONNECT_DELAY)
 {
+	m_socket.setNoDelay(m_noDelay);
+	m_reader.setWaitHandler([this]() { waitReadable(); });
 }
 
 
 NNTPClientSession::NNTPClientSession(const std::string& host, Poco::UInt16 port):
 	m_host(host),
-	m_socket(SocketAddress(host, port)),
-	m_isOpen(false)
+	m_address(host, port),
+	m_socket(m_address),
+	m_isOpen(false),
+	m_reader(m_socket, RAW_BUFFER_SIZE),
+	m_writer(m_socket, WRITE_BUFFER_SIZE),
+	m_reconnectDelay(DEFAULT_RECONNECT_DELAY)
 {
+	m_socket.setNoDelay(m_noDelay);
+	m_reader.setWaitHandler([this]() { waitReadable(); });
 }
 
 
@@ -126,6 +152,7 @@ NNTPClientSession::~NNTPClientSession()
 
 void NNTPClientSession::setTimeout(const Poco::Timespan& timeout)
 {
+	m_timeout = timeout;
 	m_socket.setReceiveTimeout(timeout);
 }
 
@@ -136,153 +163,932 @@ Poco::Timespan NNTPClientSession::getTimeout() const
 }
 
 
+void NNTPClientSession::setNoDelay(bool flag)
+{
+    m_noDelay = flag;
+    m_socket.setNoDelay(flag);
+}
+
+
+bool NNTPClientSession::getNoDelay() const
+{
+    return m_socket.getNoDelay();
+}
+
+
+void NNTPClientSession::setReceiveBufferSize(int size)
+{
+    m_receiveBufferSize = size;
+    m_socket.setReceiveBufferSize(size);
+}
+
+
+int NNTPClientSession::getReceiveBufferSize() const
+{
+    return m_socket.getReceiveBufferSize();
+}
+
+
+void NNTPClientSession::setSendBufferSize(int size)
+{
+    m_sendBufferSize = size;
+    m_socket.setSendBufferSize(size);
+}
+
+
+int NNTPClientSession::getSendBufferSize() const
+{
+    return m_socket.getSendBufferSize();
+}
+
+
+void NNTPClientSession::setQuickAck(bool flag)
+{
+    m_quickAck = flag;
+}
+
+
 void NNTPClientSession::open()
 {
 	if (!m_isOpen)
 	{
 		std::string response;
-		int status = m_socket.receiveStatusMessage(response);
+		int status = m_reader.readStatus(response);
 		if (!isPositiveCompletion(status)) throw NNTPException("The news service is unavailable", response, status);
 		m_isOpen = true;
 	}
 }
 
 
+void NNTPClientSession::login(LoginMethod loginMethod, const std::string& username, const std::string& password)
+{
+    open();
+    m_loginMethod = loginMethod;
+    m_username = username;
+    m_password = password;
+    authenticate();
+}
+
+
+void NNTPClientSession::authenticate()
+{
+    std::string response;
+    int status = 0;
+    switch (m_loginMethod)
+    {
+    case AUTH_NONE:
+        return;
+    case AUTH_LOGIN:
+        // 381 asks for the password; some servers accept the user alone with 281
+        status = sendCommand(CommandLine(CommandLine::AUTHINFO_USER).arg(m_username), response);
+        if (isPositiveIntermediate(status))
+            status = sendCommand(CommandLine(CommandLine::AUTHINFO_PASS).arg(m_password), response);
+        break;
+    case AUTH_PLAIN:
+        {
+            // authorization identity, authentication identity and password, each preceded by NUL
+            std::string credentials;
+            credentials += '\0';
+            credentials += m_username;
+            credentials += '\0';
+            credentials += m_password;
+
+            std::ostringstream credentialsBase64;
+            Base64Encoder credentialsEncoder(credentialsBase64);
+            credentialsEncoder.rdbuf()->setLineLength(0);
+            credentialsEncoder << credentials;
+            credentialsEncoder.close();
+
+            status = sendCommand(CommandLine(CommandLine::AUTHINFO_SASL).arg("PLAIN").arg(credentialsBase64.str()), response);
+        }
+        break;
+    }
+    if (!isPositiveCompletion(status)) throw NNTPException("Login failed", response, status);
+}
+
+
 void NNTPClientSession::close()
 {
 	if (m_isOpen)
 	{
 		std::string response;
-		sendCommand("QUIT", response);
+		sendCommand(CommandLine(CommandLine::QUIT), response);
 		m_socket.close();
+		m_reader.clear();
+		m_writer.clear();
 		m_isOpen = false;
 	}
 }
 
 
-std::vector<std::string> NNTPClientSession::multiLineResponse()
+void NNTPClientSession::abort()
 {
-    std::vector<std::string> response;
-    std::string line;
-    m_socket.receiveMessage(line);
-    while (line != ".")
+    m_isOpen = false;
+    m_socket.close();
+    m_reader.clear();
+    m_writer.clear();
+}
+
+
+void NNTPClientSession::setAutoReconnect(int attempts, const Poco::Timespan& delay)
+{
+    m_reconnectAttempts = attempts > 0 ? attempts : 0;
+    m_reconnectDelay = delay;
+}
+
+
+void NNTPClientSession::setLoginHandler(const LoginHandler& handler)
+{
+    m_loginHandler = handler;
+}
+
+
+void NNTPClientSession::reconnect()
+{
+    abort();
+    checkInterrupted();
+    Timespan timeout = m_timeout;
+    if (m_hasDeadline && (timeout.totalMicroseconds() <= 0 || remainingTime() < timeout))
+        timeout = remainingTime();
+    DialogSocket socket;
+    if (timeout.totalMicroseconds() > 0)
+        socket.connect(m_address, timeout);
+    else
+        socket.connect(m_address);
+    m_socket = socket;
+    applySocketOptions();
+    ++m_reconnects;
+
+    // the login handler may issue commands, which must not reconnect in turn
+    m_reconnecting = true;
+    try
+    {
+        open();
+        authenticate();
+        if (m_loginHandler)
+            m_loginHandler(*this);
+        if (!m_newsGroup.empty())
+        {
+            int status = sendCommand(CommandLine(CommandLine::GROUP).arg(m_newsGroup), m_response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot select newsgroup again", m_response, status);
+
+            const uint_t article = m_article;
+            setNewsGroup(m_newsGroup, m_response, status);
+            if (article != 0)
+            {
+                // the article may have expired meanwhile
+                status = sendCommand(CommandLine(CommandLine::STAT).arg(article), m_response);
+                if (isPositiveCompletion(status))
+                    m_article = article;
+            }
+        }
+    }
+    catch (...)
+    {
+        m_reconnecting = false;
+        throw;
+    }
+    m_reconnecting = false;
+}
+
+
+bool NNTPClientSession::recover(const Poco::Exception& exc, int& attempt)
+{
+    // a cancelled or expired operation must fail rather than start over
+    if (m_reconnecting || attempt > m_reconnectAttempts || isInterrupted() || !isConnectionLost(exc))
+        return false;
+
+    abort();
+    while (attempt <= m_reconnectAttempts && !isInterrupted())
     {
-        response.push_back(line);
-        m_socket.receiveMessage(line);
+        if (attempt > 1)
+            pause(Timespan(m_reconnectDelay.totalMicroseconds()*(attempt - 1)));
+        ++attempt;
+        try
+        {
+            reconnect();
+            return true;
+        }
+        catch (const Poco::Exception& failure)
+        {
+            if (!isConnectionLost(failure))
+                throw;
+        }
     }
+    return false;
+}
+
+
+bool NNTPClientSession::isConnectionLost(const Poco::Exception& exc)
+{
+    if (const NNTPException* nntp = dynamic_cast<const NNTPException*>(&exc))
+        return nntp->code() == 400;
+    return dynamic_cast<const NetException*>(&exc) || dynamic_cast<const Poco::TimeoutException*>(&exc);
+}
+
+
+void NNTPClientSession::applySocketOptions()
+{
+    m_socket.setNoDelay(m_noDelay);
+    if (m_timeout.totalMicroseconds() > 0)
+        m_socket.setReceiveTimeout(m_timeout);
+    if (m_receiveBufferSize > 0)
+        m_socket.setReceiveBufferSize(m_receiveBufferSize);
+    if (m_sendBufferSize > 0)
+        m_socket.setSendBufferSize(m_sendBufferSize);
+}
 
+
+std::vector<std::string> NNTPClientSession::multiLineResponse()
+{
+    std::vector<std::string> response;
+    m_reader.readLines([&response](std::string_view line) { response.emplace_back(line); });
     return response;
 }
 
+void NNTPClientSession::multiLineResponse(const std::function<void(std::string_view)>& handler)
+{
+    m_reader.readLines(handler);
+}
+
 std::vector<std::string> NNTPClientSession::capabilities()
 {
-    std::string response;
-    int status = sendCommand("CAPABILITIES", response);
-    if (!isPositiveInformation(status))
-        throw NNTPException("Cannot get capabilities", response, status);
+    return withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::CAPABILITIES), response);
+            if (!isPositiveInformation(status))
+                throw NNTPException("Cannot get capabilities", response, status);
 
-    return multiLineResponse();
+            return multiLineResponse();
+        });
 }
 
 std::vector<GroupDesc> NNTPClientSession::listNewsGroups( const std::string& wildMat )
 {
-    std::string response;
-    int status = sendCommand("LIST NEWSGROUPS", wildMat, response);
-    if (!isPositiveCompletion(status)) throw NNTPException("Cannot list newsgroups", response, status);
-
-    std::vector<std::string> groups = multiLineResponse();
-    std::vector<GroupDesc> groupDescs;
-    std::transform(groups.begin(), groups.end(), std::back_inserter(groupDescs), [](const std::string &line) {
-        auto pos = line.find_first_of(" \t");
-        if (pos == std::string::npos)
+    return withReconnect([&]()
         {
-            return GroupDesc{line, ""};
-        }
-        return GroupDesc{line.substr(0, pos), line.substr(line.find_first_not_of(" \t", pos + 1))};
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::LIST_NEWSGROUPS).arg(wildMat), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot list newsgroups", response, status);
+
+            std::vector<std::string> groups = multiLineResponse();
+            std::vector<GroupDesc> groupDescs;
+            std::transform(groups.begin(), groups.end(), std::back_inserter(groupDescs), [](const std::string &line) {
+                auto pos = line.find_first_of(" \t");
+                if (pos == std::string::npos)
+                {
+                    return GroupDesc{line, ""};
+                }
+                return GroupDesc{line.substr(0, pos), line.substr(line.find_first_not_of(" \t", pos + 1))};
+                });
+            return groupDescs;
+        });
+}
+
+void NNTPClientSession::listNewsGroups(const std::string& wildMat, GroupTable& groups)
+{
+    withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::LIST_NEWSGROUPS).arg(wildMat), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot list newsgroups", response, status);
+
+            GroupTable incoming;
+            multiLineResponse([&incoming](std::string_view text)
+                {
+                    // gmane.comp.lib.boost.user<TAB>Boost users mailing list
+                    std::string::size_type pos = text.find_first_of(" \t");
+                    std::string_view name = text.substr(0, pos);
+                    std::string_view description;
+                    if (pos != std::string::npos)
+                    {
+                        pos = text.find_first_not_of(" \t", pos);
+                        if (pos != std::string::npos)
+                            description = text.substr(pos);
+                    }
+                    incoming.add(name, description);
+                });
+            groups.merge(incoming);
+        });
+}
+
+void NNTPClientSession::listActive(const std::string& wildMat, GroupTable& groups)
+{
+    withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::LIST_ACTIVE).arg(wildMat), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot list active newsgroups", response, status);
+
+            GroupTable incoming;
+            multiLineResponse([&incoming](std::string_view line) { addActive(line, incoming); });
+            groups.merge(incoming);
+        });
+}
+
+void NNTPClientSession::newGroups(const Poco::Timestamp& since, GroupTable& groups)
+{
+    withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::NEWGROUPS).arg(DateTimeFormatter::format(since, "%Y%m%d %H%M%S GMT")), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot list new newsgroups", response, status);
+
+            GroupTable incoming;
+            multiLineResponse([&incoming](std::string_view line) { addActive(line, incoming); });
+            groups.merge(incoming);
+        });
+}
+
+Poco::Timestamp NNTPClientSession::date()
+{
+    return withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::DATE), response);
+            if (!isPositiveInformation(status)) throw NNTPException("Cannot get server date", response, status);
+
+            // 111 20240101123456
+            int tzd;
+            DateTime dateTime;
+            if (response.size() < 18 || !DateTimeParser::tryParse("%Y%m%d%H%M%S", response.substr(4, 14), dateTime, tzd))
+                throw NNTPException("Invalid server date", response, status);
+            return dateTime.timestamp();
         });
-    return groupDescs;
 }
 
 ActiveNewsGroup NNTPClientSession::selectNewsGroup( const std::string& newsgroup )
 {
-    std::string response;
-    int status = sendCommand("GROUP", newsgroup, response);
-    if (!isPositiveCompletion(status)) throw NNTPException("Cannot set newsgroup", response, status);
+    return withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::GROUP).arg(newsgroup), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot set newsgroup", response, status);
 
-    // 211 90986 1 91036 gmane.comp.lib.boost.user
-    StringTokenizer groupInfo(response, " ");
-    m_newsGroup = newsgroup;
-    m_numArticles = NumberParser::parseUnsigned(groupInfo[1]);
-    m_lowArticle = NumberParser::parseUnsigned(groupInfo[2]);
-    m_highArticle = NumberParser::parseUnsigned(groupInfo[3]);
-    return { m_newsGroup, m_numArticles, m_lowArticle, m_highArticle };
+            return setNewsGroup(newsgroup, response, status);
+        });
+}
+
+ActiveNewsGroup NNTPClientSession::listGroup(const std::string& newsgroup, ArticleSet& articles)
+{
+    return withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::LISTGROUP).arg(newsgroup), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot list newsgroup", response, status);
+
+            ActiveNewsGroup group = setNewsGroup(newsgroup, response, status);
+
+            // numbers arrive in ascending order, so collect runs before adding them
+            uint_t first = 0;
+            uint_t last = 0;
+            multiLineResponse([&](std::string_view line)
+            {
+                uint_t number;
+                if (std::from_chars(line.data(), line.data() + line.size(), number).ec != std::errc())
+                    return;
+                if (first != 0 && number == last + 1)
+                {
+                    last = number;
+                    return;
+                }
+                if (first != 0)
+                    articles.add(first, last);
+                first = last = number;
+            });
+            if (first != 0)
+                articles.add(first, last);
+            return group;
+        });
 }
 
 std::vector<std::string> NNTPClientSession::articleHeader()
 {
-    std::string response;
-    int status = sendCommand("HEAD", response);
-    if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article header", response, status);
+    return withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::HEAD), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article header", response, status);
 
-    return multiLineResponse();
+            return multiLineResponse();
+        });
 }
 
 std::vector<std::string> NNTPClientSession::articleRaw()
+{
+    return withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::ARTICLE), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article body", response, status);
+
+            return multiLineResponse();
+        });
+}
+
+std::vector<std::string> NNTPClientSession::articleRaw(uint_t number)
+{
+    return withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::ARTICLE).arg(number), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article body", response, status);
+
+            m_article = number;
+            return multiLineResponse();
+        });
+}
+
+std::vector<std::string> NNTPClientSession::articleRaw(const std::string& messageId)
+{
+    return withReconnect([&]()
+        {
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::ARTICLE).arg(messageId), response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article body", response, status);
+
+            return multiLineResponse();
+        });
+}
+
+void NNTPClientSession::articles(const std::vector<std::string>& requests, const ArticleHandler& handler, std::size_t window)
 {
     std::string response;
-    int status = sendCommand("ARTICLE", response);
-    if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article body", response, status);
+    std::string text;
+    std::size_t received = 0;
+    window = std::max<std::size_t>(window, 1);
+    withReconnect([&]()
+        {
+            // after a reconnect, the requests not answered yet are sent again
+            std::size_t sent = received;
+            for (; received < requests.size(); ++received)
+            {
+                while (sent < requests.size() && sent - received < window)
+                    sendCommand(CommandLine(CommandLine::ARTICLE).arg(requests[sent++]));
+
+                int status = receiveStatus(response);
+                text.clear();
+                if (isPositiveCompletion(status))
+                {
+                    m_reader.readBlocks([&text](const char* data, std::size_t size) { text.append(data, size); });
+                }
+                else if (status != 423 && status != 430)
+                {
+                    // the responses still outstanding would otherwise be
+                    // taken for those of the next command
+                    try
+                    {
+                        std::string pending;
+                        for (std::size_t drained = received + 1; drained < sent; ++drained)
+                        {
+                            if (isPositiveCompletion(receiveStatus(pending)))
+                                m_reader.readBlocks([](const char*, std::size_t) {});
+                        }
+                    }
+                    catch (const Poco::Exception&)
+                    {
+                        abort();
+                    }
+                    throw NNTPException("Cannot get article", response, status);
+                }
+                handler(received, status, text);
+            }
+        }, [&received]() { return received; });
+}
+
+std::streamsize NNTPClientSession::articleTo(const std::string& request, std::ostream& out)
+{
+    // once text has been written, the article cannot be fetched again
+    int status = withReconnect([&]() { return sendCommand(CommandLine(CommandLine::ARTICLE).arg(request), m_response); });
+    if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article", m_response, status);
+
+    setArticle(request);
+    std::streamsize written = m_reader.readBlocks([&out](const char* data, std::size_t size) { out.write(data, static_cast<std::streamsize>(size)); });
+    if (!out) throw WriteFileException("Cannot write article");
+    return written;
+}
+
+std::streamsize NNTPClientSession::articleTo(const std::string& request, std::string& text)
+{
+    const std::size_t size = text.size();
+    return withReconnect([&]()
+        {
+            text.resize(size);
+            int status = sendCommand(CommandLine(CommandLine::ARTICLE).arg(request), m_response);
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article", m_response, status);
+
+            setArticle(request);
+            return m_reader.readBlocks([&text](const char* data, std::size_t size) { text.append(data, size); });
+        });
+}
+
+std::streamsize NNTPClientSession::bodyTo(const std::string& request, std::ostream& out)
+{
+    int status = withReconnect([&]() { return sendCommand(CommandLine(CommandLine::BODY).arg(request), m_response); });
+    if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article body", m_response, status);
+
+    setArticle(request);
+    std::streamsize written = m_reader.readBlocks([&out](const char* data, std::size_t size) { out.write(data, static_cast<std::streamsize>(size)); });
+    if (!out) throw WriteFileException("Cannot write article body");
+    return written;
+}
+
+void NNTPClientSession::overview(uint_t low, uint_t high, std::vector<OverviewRecord>& records)
+{
+    OverviewRecord record;
+    overview(low, high, [&records, &record](const std::string& line)
+        {
+            if (parseOverview(line, record))
+                records.push_back(std::move(record));
+        });
+}
+
+void NNTPClientSession::overview(uint_t low, uint_t high, OverviewBatch& batch)
+{
+    batch.setFormat(overviewFormat());
+
+    const std::size_t initial = batch.size();
+    withReconnect([&]()
+        {
+            // after a reconnect, carry on after the last record received
+            uint_t first = low;
+            if (batch.size() > initial)
+            {
+                if (batch.number(batch.size() - 1) >= high)
+                    return;
+                first = batch.number(batch.size() - 1) + 1;
+            }
+
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::OVER).range(first, high), response);
+            if (status == 423)
+                return; // no articles in the range
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot get overview", response, status);
+
+            // blocks end anywhere, so an unfinished last line waits for the next one
+            std::string pending;
+            m_reader.readBlocks([&batch, &pending](const char* data, std::size_t size)
+                {
+                    if (!pending.empty())
+                    {
+                        // only the rest of the unfinished line is copied
+                        const char* end = data + size;
+                        const char* lf = ResponseReader::findLineFeed(data, end);
+                        if (lf == end)
+                        {
+                            pending.append(data, size);
+                            return;
+                        }
+                        pending.append(data, lf + 1);
+                        batch.addLines(pending);
+                        pending.clear();
+                        data = lf + 1;
+                        size = static_cast<std::size_t>(end - data);
+                    }
+                    const std::size_t used = batch.addLines(std::string_view(data, size));
+                    pending.assign(data + used, size - used);
+                });
+            if (!pending.empty())
+                batch.add(pending);
+        }, [&batch]() { return batch.size(); });
+}
+
+const std::vector<std::string>& NNTPClientSession::overviewFormat()
+{
+    if (m_overviewFormat.empty())
+    {
+        withReconnect([this]()
+            {
+                std::string response;
+                int status = sendCommand(CommandLine(CommandLine::LIST).arg("OVERVIEW.FMT"), response);
+                if (isPositiveCompletion(status))
+                    m_overviewFormat = multiLineResponse();
+            });
+        if (m_overviewFormat.empty())
+            m_overviewFormat = {"Subject:", "From:", "Date:", "Message-ID:", "References:", ":bytes", ":lines"};
+    }
+    return m_overviewFormat;
+}
 
-    return multiLineResponse();
+void NNTPClientSession::overview(uint_t low, uint_t high, const std::function<void(const std::string&)>& handler)
+{
+    std::string line;
+    uint_t first = low;
+    std::size_t lines = 0;
+    withReconnect([&]()
+        {
+            // after a reconnect, carry on after the last line received
+            if (first > high)
+                return;
+
+            std::string response;
+            int status = sendCommand(CommandLine(CommandLine::OVER).range(first, high), response);
+            if (status == 423)
+                return; // no articles in the range
+            if (!isPositiveCompletion(status)) throw NNTPException("Cannot get overview", response, status);
+
+            multiLineResponse([&](std::string_view text)
+                {
+                    line.assign(text.data(), text.size());
+                    handler(line);
+                    ++lines;
+                    uint_t number;
+                    if (std::from_chars(text.data(), text.data() + text.size(), number).ec == std::errc() && number >= first)
+                        first = number + 1;
+                });
+        }, [&lines]() { return lines; });
+}
+
+bool NNTPClientSession::parseOverview(std::string_view line, OverviewRecord& record)
+{
+    // number, Subject, From, Date, Message-ID, References, :bytes, :lines
+    std::string_view fields[8];
+    std::size_t count = 0;
+    std::size_t begin = 0;
+    while (count < 8)
+    {
+        std::size_t end = line.find('\t', begin);
+        fields[count++] = line.substr(begin, end == std::string_view::npos ? end : end - begin);
+        if (end == std::string_view::npos)
+            break;
+        begin = end + 1;
+    }
+    if (count < 8)
+        return false;
+
+    if (std::from_chars(fields[0].data(), fields[0].data() + fields[0].size(), record.number).ec != std::errc())
+        return false;
+    record.subject.assign(fields[1].data(), fields[1].size());
+    record.from.assign(fields[2].data(), fields[2].size());
+    record.date.assign(fields[3].data(), fields[3].size());
+    record.messageId.assign(fields[4].data(), fields[4].size());
+    record.references.assign(fields[5].data(), fields[5].size());
+    record.bytes = 0;
+    record.lines = 0;
+    std::from_chars(fields[6].data(), fields[6].data() + fields[6].size(), record.bytes);
+    std::from_chars(fields[7].data(), fields[7].data() + fields[7].size(), record.lines);
+    return true;
 }
 
 void NNTPClientSession::article(NewsArticle &article)
 {
     std::string response;
-    int status = sendCommand("ARTICLE", response);
+    int status = withReconnect([&]() { return sendCommand(CommandLine(CommandLine::ARTICLE), response); });
     if (!isPositiveCompletion(status))
         throw NNTPException("Cannot get article body", response, status);
 
-    DialogInputStream sis(m_socket);
-    MailInputStream mis(sis);
-    article.read(mis);
-    while (mis.good())
-        mis.get(); // read any remaining junk
+    readArticle(article);
 }
 
 bool NNTPClientSession::stat(uint_t article)
 {
-    std::string response;
-    int status = sendCommand("STAT", std::to_string(article), response);
-    return isPositiveCompletion(status);
+    return withReconnect([&]()
+        {
+            int status = sendCommand(CommandLine(CommandLine::STAT).arg(article), m_response);
+            if (!isPositiveCompletion(status))
+                return false;
+
+            m_article = article;
+            return true;
+        });
+}
+
+bool NNTPClientSession::stat(uint_t article, std::string& messageId)
+{
+    return withReconnect([&]()
+        {
+            int status = sendCommand(CommandLine(CommandLine::STAT).arg(article), m_response);
+            if (!isPositiveCompletion(status))
+                return false;
+
+            m_article = article;
+            // 223 3000234 <45223423@example.com>
+            const std::string_view id = StatusLine(m_response)[2];
+            messageId.assign(id.data(), id.size());
+            return true;
+        });
 }
 
 void NNTPClientSession::article(uint_t number, NewsArticle &article)
+{
+    int status = withReconnect([&]() { return sendCommand(CommandLine(CommandLine::ARTICLE).arg(number), m_response); });
+    if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article body", m_response, status);
+
+    m_article = number;
+    readArticle(article);
+}
+
+void NNTPClientSession::readArticle(NewsArticle& article)
+{
+    // the reader unstuffs the text and stops at the terminator, within the current scope
+    std::string text;
+    m_reader.readBlocks([&text](const char* data, std::size_t size) { text.append(data, size); });
+    std::istringstream stream(text);
+    article.read(stream);
+}
+
+void NNTPClientSession::post(const NewsArticle& article)
+{
+    beginPost();
+    SocketOutputStream socketStream(m_socket);
+    MailOutputStream mailStream(socketStream);
+    article.write(mailStream);
+    mailStream.close();
+    socketStream.flush();
+    endPost();
+}
+
+void NNTPClientSession::post(std::istream& article)
+{
+    beginPost();
+    SocketOutputStream socketStream(m_socket);
+    MailOutputStream mailStream(socketStream);
+    StreamCopier::copyStream(article, mailStream);
+    mailStream.close();
+    socketStream.flush();
+    endPost();
+}
+
+void NNTPClientSession::beginPost()
+{
+    std::string response;
+    int status = sendCommand(CommandLine(CommandLine::POST), response);
+    if (!isPositiveIntermediate(status)) throw NNTPException("Posting not permitted", response, status);
+}
+
+void NNTPClientSession::endPost()
 {
     std::string response;
-    int status = sendCommand("ARTICLE", std::to_string(number), response);
-    if (!isPositiveCompletion(status)) throw NNTPException("Cannot get article body", response, status);
+    int status = receiveStatus(response);
+    if (!isPositiveCompletion(status)) throw NNTPException("Posting failed", response, status);
+}
+
+void NNTPClientSession::sendCommand(const CommandLine& command)
+{
+    m_writer.write(command.line());
+}
+
+
+int NNTPClientSession::sendCommand(const CommandLine& command, std::string& response)
+{
+    sendCommand(command);
+    return receiveStatus(response);
+}
+
+
+ActiveNewsGroup NNTPClientSession::setNewsGroup(const std::string& newsgroup, const std::string& response, int status)
+{
+    // 211 90986 1 91036 gmane.comp.lib.boost.user
+    StatusLine groupInfo(response);
+    uint_t numArticles;
+    uint_t lowArticle;
+    uint_t highArticle;
+    if (!groupInfo.number(1, numArticles) || !groupInfo.number(2, lowArticle) || !groupInfo.number(3, highArticle))
+        throw NNTPException("Invalid group response", response, status);
+
+    m_newsGroup = newsgroup;
+    m_article = 0;
+    m_numArticles = numArticles;
+    m_lowArticle = lowArticle;
+    m_highArticle = highArticle;
+    return { m_newsGroup, m_numArticles, m_lowArticle, m_highArticle };
+}
+
+
+void NNTPClientSession::setArticle(std::string_view request)
+{
+    uint_t number;
+    const std::from_chars_result result = std::from_chars(request.data(), request.data() + request.size(), number);
+    if (result.ec == std::errc() && result.ptr == request.data() + request.size())
+        m_article = number;
+}
+
+
+int NNTPClientSession::receiveStatus(std::string& response)
+{
+    m_writer.flush();
+#if defined(TCP_QUICKACK)
+    if (m_quickAck)
+        m_socket.setOption(IPPROTO_TCP, TCP_QUICKACK, 1);
+#endif
+    return m_reader.readStatus(response);
+}
+
+
+bool NNTPClientSession::responseReady()
+{
+    return m_reader.pending() || m_socket.poll(Poco::Timespan(0), Socket::SELECT_READ);
+}
+
+
+bool NNTPClientSession::isInterrupted() const
+{
+    return (m_token && m_token->isCancelled()) || (m_hasDeadline && remainingTime().totalMicroseconds() <= 0);
+}
+
+
+void NNTPClientSession::checkInterrupted()
+{
+    if (m_token && m_token->isCancelled())
+    {
+        abort();
+        throw NNTPCancelledException("Operation cancelled");
+    }
+    if (m_hasDeadline && remainingTime().totalMicroseconds() <= 0)
+    {
+        abort();
+        throw Poco::TimeoutException("Operation deadline exceeded");
+    }
+}
+
+
+void NNTPClientSession::waitReadable()
+{
+    if (!m_hasDeadline && !m_token)
+        return;
+
+    // polling replaces the blocking read, so the timeout must be applied here too
+    const Timestamp start;
+    for (;;)
+    {
+        checkInterrupted();
+        Timespan wait = m_hasDeadline ? remainingTime() : Timespan(CANCEL_POLL_INTERVAL);
+        if (m_token && wait.totalMicroseconds() > CANCEL_POLL_INTERVAL)
+            wait = Timespan(CANCEL_POLL_INTERVAL);
+        if (m_timeout.totalMicroseconds() > 0)
+        {
+            const Timespan left = m_timeout - Timespan(start.elapsed());
+            if (left.totalMicroseconds() <= 0)
+                throw Poco::TimeoutException("No response from the server");
+            if (left < wait)
+                wait = left;
+        }
+        if (wait.totalMicroseconds() > 0 && m_socket.poll(wait, Socket::SELECT_READ))
+            return;
+    }
+}
+
+
+void NNTPClientSession::pause(const Timespan& delay)
+{
+    const Timestamp start;
+    for (;;)
+    {
+        checkInterrupted();
+        Timespan wait = delay - Timespan(start.elapsed());
+        if (wait.totalMicroseconds() <= 0)
+            return;
+        if (m_hasDeadline && remainingTime() < wait)
+            wait = remainingTime();
+        if (m_token && wait.totalMicroseconds() > CANCEL_POLL_INTERVAL)
+            wait = Timespan(CANCEL_POLL_INTERVAL);
+        // round up, so that the last slice does not spin
+        Poco::Thread::sleep(static_cast<long>((wait.totalMicroseconds() + 999)/1000));
+    }
+}
+
+
+Timespan NNTPClientSession::remainingTime() const
+{
+    return Timespan(m_deadline - Timestamp());
+}
+
 
-    DialogInputStream sis(m_socket);
-    MailInputStream mis(sis);
-    article.read(mis);
-    while (mis.good()) mis.get(); // read any remaining junk
+NNTPClientSession::OperationScope::OperationScope(NNTPClientSession& session, const Timespan& timeout, const CancellationToken* token):
+    m_session(session),
+    m_deadline(session.m_deadline),
+    m_hasDeadline(session.m_hasDeadline),
+    m_token(session.m_token)
+{
+    const Timestamp deadline = Timestamp() + timeout;
+    if (!m_hasDeadline || deadline < m_deadline)
+        session.m_deadline = deadline;
+    session.m_hasDeadline = true;
+    if (token)
+        session.m_token = token;
 }
 
-int NNTPClientSession::sendCommand(const std::string& command, std::string& response)
+
+NNTPClientSession::OperationScope::OperationScope(NNTPClientSession& session, const CancellationToken& token):
+    m_session(session),
+    m_deadline(session.m_deadline),
+    m_hasDeadline(session.m_hasDeadline),
+    m_token(session.m_token)
 {
-	m_socket.sendMessage(command);
-	return m_socket.receiveStatusMessage(response);
+    session.m_token = &token;
 }
 
 
-int NNTPClientSession::sendCommand(const std::string& command, const std::string& arg, std::string& response)
+NNTPClientSession::OperationScope::~OperationScope()
 {
-	m_socket.sendMessage(command, arg);
-	return m_socket.receiveStatusMessage(response);
+    m_session.m_deadline = m_deadline;
+    m_session.m_hasDeadline = m_hasDeadline;
+    m_session.m_token = m_token;
 }
 
 
 POCO_IMPLEMENT_EXCEPTION(NNTPException, NetException, "NNTP Exception")
+POCO_IMPLEMENT_EXCEPTION(NNTPCancelledException, NNTPException, "NNTP operation cancelled")
 
 } } // namespace Poco::Net
@@ -13,13 +13,23 @@
 #define Net_NNTPClientSession_INCLUDED
 
 
+#include "CommandWriter.h"
+#include "ResponseReader.h"
+
 #include "Poco/Net/Net.h"
 #include "Poco/Net/DialogSocket.h"
 #include "Poco/Net/NetException.h"
+#include "Poco/Net/SocketAddress.h"
 #include "Poco/Exception.h"
 #include "Poco/Timespan.h"
+#include "Poco/Timestamp.h"
 
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <ostream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -28,11 +38,17 @@ namespace Net {
 
 #define NNTP_API
 
+class ArticleSet;
+class CancellationToken;
+class CommandLine;
+class GroupTable;
 class MailMessage;
+class OverviewBatch;
 
 using NewsArticle = MailMessage;
 
 POCO_DECLARE_EXCEPTION(NNTP_API, NNTPException, NetException)
+POCO_DECLARE_EXCEPTION(NNTP_API, NNTPCancelledException, NNTPException)
 
 using uint_t = unsigned int;
 
@@ -46,6 +62,19 @@ struct ActiveNewsGroup
 
 using GroupDesc = std::pair<std::string, std::string>;
 
+struct OverviewRecord
+    /// The mandatory overview fields of an article (RFC 3977).
+{
+    uint_t number{};
+    std::string subject;
+    std::string from;
+    std::string date;
+    std::string messageId;
+    std::string references;
+    std::size_t bytes{};
+    std::size_t lines{};
+};
+
 class NNTP_API NNTPClientSession
 	/// This class implements an Network News
 	/// Transfer Protocol (NNTP, RFC 2821)
@@ -56,14 +85,22 @@ public:
 
 	enum
 	{
-		NNTP_PORT = 119
+		NNTP_PORT = 119,
+		DEFAULT_RECONNECT_DELAY = 2000000, // 2 seconds, growing with each further attempt
+		DEFAULT_PIPELINE_WINDOW = 16, // ARTICLE commands outstanding in articles()
+		RAW_BUFFER_SIZE = 256*1024,   // receive buffer for multi-line responses
+		WRITE_BUFFER_SIZE = 64*1024,  // send buffer for coalesced commands
+		CANCEL_POLL_INTERVAL = 100000 // how often waiting reads look at the cancellation token
 	};
 
+    using ArticleHandler = std::function<void(std::size_t index, int status, std::string& article)>;
+    using LoginHandler = std::function<void(NNTPClientSession& session)>;
+
 	enum LoginMethod
 	{
 		AUTH_NONE,
-		AUTH_LOGIN,
-		AUTH_PLAIN
+		AUTH_LOGIN, // AUTHINFO USER/PASS (RFC 4643)
+		AUTH_PLAIN  // AUTHINFO SASL PLAIN with an initial response (RFC 4643, 4616)
 	};
 
 	explicit NNTPClientSession(const StreamSocket& socket);
@@ -84,6 +121,40 @@ public:
     Timespan getTimeout() const;
 		/// Returns the timeout for socket read operations.
 
+    void setNoDelay(bool flag);
+        /// Disables Nagle's algorithm (TCP_NODELAY) if flag is true.
+        ///
+        /// The session coalesces commands itself and sends them when
+        /// it is about to wait for a response, so Nagle's algorithm
+        /// would only hold back the last segment of each burst until
+        /// the server's delayed ACK; it is disabled by default.
+
+    bool getNoDelay() const;
+
+    void setReceiveBufferSize(int size);
+        /// Sets the size of the socket's receive buffer (SO_RCVBUF).
+        /// Large buffers let the server keep streaming big ARTICLE
+        /// responses, or pipelined ones, over links with a large
+        /// bandwidth-delay product. Should be set before open().
+
+    int getReceiveBufferSize() const;
+
+    void setSendBufferSize(int size);
+        /// Sets the size of the socket's send buffer (SO_SNDBUF),
+        /// which bounds how much of a coalesced write the kernel
+        /// takes at once.
+
+    int getSendBufferSize() const;
+
+    void setQuickAck(bool flag);
+        /// If flag is true, asks the kernel to acknowledge responses
+        /// at once rather than delaying the ACK (TCP_QUICKACK). Linux
+        /// drops the option as it sees fit, so the session sets it
+        /// again before reading each status line. Ignored on systems
+        /// without the option.
+
+    bool getQuickAck() const;
+
 	void open();
 		/// Reads the initial response from the NNTP server.
 		///
@@ -93,22 +164,248 @@ public:
 		///
 		/// Does nothing if called more than once.
 
+    void login(LoginMethod loginMethod, const std::string& username, const std::string& password);
+        /// Calls open(), then authenticates with the given method and
+        /// credentials. AUTH_NONE only opens the session.
+        ///
+        /// The credentials are kept so that reconnect() can
+        /// authenticate again, before it calls the login handler.
+        /// Either method sends the password in the clear (PLAIN only
+        /// Base64-encoded), so it should only be used over a
+        /// connection that is trusted or encrypted.
+        ///
+        /// Throws a NNTPException carrying the server status if the
+        /// server rejects the credentials (481) or authentication is
+        /// not available (502, 503).
+
 	void close();
 		/// Sends a QUIT command and closes the connection to the server.
 		///
 		/// Throws a NNTPException in case of a NNTP-specific error, or a
 		/// NetException in case of a general network communication failure.
 
+    void abort();
+        /// Closes the connection without sending QUIT.
+        ///
+        /// Used to drop a session whose connection is in an unknown
+        /// state, e.g. after a network error in the middle of a response.
+
+    bool isOpen() const;
+        /// Returns true if the server greeting has been received
+        /// and the session has not been closed.
+
+    void setAutoReconnect(int attempts, const Timespan& delay = Timespan(DEFAULT_RECONNECT_DELAY));
+        /// Lets commands survive a lost connection: if the server
+        /// drops it or says goodbye with 400 (e.g. after an idle
+        /// timeout), or a socket error or timeout occurs, the session
+        /// reconnects and carries on, up to attempts times in a row.
+        /// The first attempt is made at once, each further one after
+        /// another delay.
+        ///
+        /// Commands are repeated from where they stopped: pipelined
+        /// articles() requests that were not answered yet are sent
+        /// again, and overview ranges resume after the last record
+        /// received. Streaming an article to an ostream is repeated
+        /// only until its text starts to arrive, and post() is never
+        /// repeated, since the article may have been accepted.
+        ///
+        /// The default of 0 attempts turns this off.
+
+    int getAutoReconnect() const;
+
+    void setLoginHandler(const LoginHandler& handler);
+        /// Sets the function called on each reconnect after the
+        /// server greeting has been read and the credentials given
+        /// to login() have been sent, e.g. to switch modes or to
+        /// authenticate in other ways.
+
+    void reconnect();
+        /// Drops the connection and connects again to the same
+        /// address, reads the greeting, authenticates as login() did
+        /// and calls the login handler.
+        /// Then the selected group and the current article, if any,
+        /// are selected again, so the session can carry on where the
+        /// connection was lost.
+        ///
+        /// The socket options set through the session (timeout,
+        /// TCP_NODELAY, buffer sizes) are applied to the new socket.
+        /// Sessions created from a socket reconnect to its peer with
+        /// a plain StreamSocket.
+
+    std::size_t reconnects() const;
+        /// Returns the number of times the session has reconnected.
+
     std::vector<std::string> capabilities();
     std::vector<GroupDesc> listNewsGroups( const std::string& wildMat );
+    void listNewsGroups(const std::string& wildMat, GroupTable& groups);
+        /// Adds the names and descriptions of the groups matching
+        /// wildMat to the given table, updating the descriptions of
+        /// groups already in it. Lines are parsed straight into the
+        /// table without intermediate strings.
+
+    void listActive(const std::string& wildMat, GroupTable& groups);
+        /// Adds the article ranges and posting status of the groups
+        /// matching wildMat (LIST ACTIVE) to the given table.
+
+    void newGroups(const Poco::Timestamp& since, GroupTable& groups);
+        /// Adds the groups created on the server since the given
+        /// time (NEWGROUPS) to the given table, with their active data.
+
+    Poco::Timestamp date();
+        /// Returns the server's current time (DATE), which should be
+        /// used as the reference for later NEWGROUPS requests.
     ActiveNewsGroup selectNewsGroup( const std::string& newsgroup );
+    ActiveNewsGroup listGroup(const std::string& newsgroup, ArticleSet& articles);
+        /// Selects the given group like selectNewsGroup() and adds
+        /// the numbers of the articles present in it (LISTGROUP) to
+        /// articles, which shows the gaps left by expired or
+        /// cancelled articles within the low..high range.
     std::vector<std::string> articleHeader();
     std::vector<std::string> articleRaw();
+    std::vector<std::string> articleRaw(uint_t number);
+    std::vector<std::string> articleRaw(const std::string& messageId);
+        /// Retrieves the article with the given number in the
+        /// selected group, or with the given message-id, as
+        /// unstuffed lines without line terminators.
+        ///
+        /// Throws a NNTPException carrying the server status (e.g. 430
+        /// for no such article) if the article is not available.
+
+    void articles(const std::vector<std::string>& requests, const ArticleHandler& handler, std::size_t window = DEFAULT_PIPELINE_WINDOW);
+        /// Retrieves the articles with the given numbers or message-ids,
+        /// keeping up to window ARTICLE commands outstanding.
+        ///
+        /// For each request, in order, the handler receives its index,
+        /// the server status and the unstuffed article text with CRLF
+        /// line endings; the text is empty if the article does not
+        /// exist (423, 430). The handler may swap the text with an
+        /// empty buffer of its own to take it without copying, which
+        /// lets the caller recycle buffers instead of allocating.
+        ///
+        /// Only framing is done here; parsing is left to the handler.
+        /// If an exception is thrown, responses may still be pending
+        /// and the session should be aborted.
+
+    std::streamsize articleTo(const std::string& request, std::ostream& out);
+        /// Streams the article with the given number or message-id
+        /// verbatim to out and returns the number of bytes written.
+        ///
+        /// The response is read from the socket in large blocks and
+        /// passed on between dot-stuffed lines without copying, so no
+        /// per-line strings are created and the output sees only a few
+        /// large writes. Lines keep their CRLF terminators.
+        ///
+        /// Throws a NNTPException carrying the server status if the
+        /// article is not available.
+
+    std::streamsize articleTo(const std::string& request, std::string& text);
+        /// Appends the article to text, like articleTo() above.
+
+    std::streamsize bodyTo(const std::string& request, std::ostream& out);
+        /// Streams the body of the article with the given number or
+        /// message-id to out, like articleTo().
+
+    void overview(uint_t low, uint_t high, std::vector<OverviewRecord>& records);
+        /// Appends the overview records (OVER) of the articles in
+        /// low..high of the current group to records.
+
+    void overview(uint_t low, uint_t high, OverviewBatch& batch);
+        /// Appends the overview records of the articles in low..high
+        /// of the current group to the batch, column by column.
+        ///
+        /// The response is read in large blocks and parsed in place
+        /// according to overviewFormat(), without per-line strings.
+
+    const std::vector<std::string>& overviewFormat();
+        /// Returns the server's overview field order (LIST
+        /// OVERVIEW.FMT) without the article number, as read once per
+        /// session; servers that lack the command are assumed to send
+        /// the standard fields.
+
+    void overview(uint_t low, uint_t high, const std::function<void(const std::string&)>& handler);
+        /// Passes the unparsed overview lines of the articles in
+        /// low..high to the handler. An empty range (423) yields
+        /// no lines.
+
+    static bool parseOverview(std::string_view line, OverviewRecord& record);
+        /// Parses an overview line; returns false if the line lacks
+        /// any of the mandatory fields.
 
     void article(NewsArticle &article);
     bool stat(uint_t article);
+    bool stat(uint_t article, std::string& messageId);
+        /// Selects the given article in the current group and
+        /// stores its message-id if it exists.
     void article(uint_t number, NewsArticle &article);
 
+    void post(const NewsArticle& article);
+        /// Posts the given article. The article must carry at least
+        /// the From, Newsgroups and Subject headers.
+        ///
+        /// The article is written with MailMessage::write() directly
+        /// to the socket; dot-stuffing is applied while streaming.
+        ///
+        /// Throws a NNTPException if posting is not permitted (440)
+        /// or the server rejects the article (441).
+
+    void post(std::istream& article);
+        /// Posts an article read verbatim from the given stream,
+        /// e.g. one previously written with MailMessage::write().
+
+    const std::string& newsGroup() const;
+        /// Returns the name of the currently selected newsgroup,
+        /// or an empty string if no group has been selected.
+
+    uint_t currentArticle() const;
+        /// Returns the number of the article last selected by number
+        /// (stat(), articleRaw(), articleTo() etc.), or 0.
+
+    class NNTP_API OperationScope
+        /// Bounds the commands a session runs during its lifetime by
+        /// a deadline for the whole operation and/or a cancellation
+        /// token, unlike the timeout, which applies to each read:
+        ///
+        ///     NNTPClientSession::OperationScope scope(session, Timespan(10, 0), &token);
+        ///     session.articleTo(id, out);
+        ///
+        /// Whenever a command waits for the server, including in the
+        /// middle of a streamed article, the session checks both. If
+        /// the deadline passes, the connection is dropped and a
+        /// TimeoutException is thrown; if the token is cancelled, it
+        /// is dropped within CANCEL_POLL_INTERVAL and a
+        /// NNTPCancelledException is thrown. Automatic reconnects are
+        /// not attempted after either, and the session must be
+        /// reconnected before it is used again.
+        ///
+        /// Scopes may be nested: the earlier deadline applies, and an
+        /// inner token replaces the outer one. Only reads are bounded;
+        /// writes are subject to the socket's send timeout.
+    {
+    public:
+        OperationScope(NNTPClientSession& session, const Timespan& timeout, const CancellationToken* token = nullptr);
+            /// Sets a deadline timeout from now, and the token if
+            /// one is given.
+
+        OperationScope(NNTPClientSession& session, const CancellationToken& token);
+            /// Sets the token without a deadline.
+
+        ~OperationScope();
+            /// Restores the deadline and token set before.
+
+    private:
+        OperationScope(const OperationScope&) = delete;
+        OperationScope& operator=(const OperationScope&) = delete;
+
+        NNTPClientSession& m_session;
+        Timestamp m_deadline;
+        bool m_hasDeadline;
+        const CancellationToken* m_token;
+    };
+
+    bool isInterrupted() const;
+        /// Returns true if the token of the current OperationScope
+        /// has been cancelled or its deadline has passed.
+
 protected:
 	enum StatusClass
 	{
@@ -132,32 +429,121 @@ protected:
 	DialogSocket& socket();
 	const std::string& host() const;
 
-private:
-	int sendCommand(const std::string& command, std::string& response);
-		/// Sends the given command verbatim to the server
-		/// and waits for a response.
-		///
-		/// Throws a NNTPException in case of a NNTP-specific error, or a
-		/// NetException in case of a general network communication failure.
+    CommandWriter& commandWriter();
+        /// Returns the buffer that collects outgoing commands.
+
+    void sendCommand(const CommandLine& command);
+        /// Queues the command line without waiting for a response,
+        /// e.g. to pipeline commands. Queued commands are sent by the
+        /// next receiveStatus(), or when the buffer is full.
+
+    int sendCommand(const CommandLine& command, std::string& response);
+        /// Sends the command line and waits for a response.
+        ///
+        /// Throws a NNTPException in case of a NNTP-specific error, or a
+        /// NetException in case of a general network communication failure.
+
+    int receiveStatus(std::string& response);
+        /// Sends any queued commands and reads a status line through
+        /// the response reader, within the current OperationScope.
+
+    bool responseReady();
+        /// Returns true if a response can be read without waiting,
+        /// because the reader holds buffered bytes or the socket is
+        /// readable.
+
+    bool recover(const Poco::Exception& exc, int& attempt);
+        /// Reconnects after exc if it shows a lost connection and
+        /// automatic reconnects allow another attempt; attempt counts
+        /// the attempts made for the current command, starting at 1.
+        /// Returns false, leaving the session alone, if the command
+        /// should fail with exc instead. Throws if reconnecting fails
+        /// for a reason other than the network, or if the current
+        /// OperationScope is cancelled or expires while waiting to
+        /// reconnect.
+
+    static bool isConnectionLost(const Poco::Exception& exc);
+        /// Returns true if exc shows that the connection is gone:
+        /// a network error or timeout, or a 400 response.
+
+    void pause(const Timespan& delay);
+        /// Sleeps for delay in slices, dropping the connection and
+        /// throwing as soon as the current OperationScope is cancelled
+        /// or expires.
 
-	int sendCommand(const std::string& command, const std::string& arg, std::string& response);
-		/// Sends the given command verbatim to the server
-		/// and waits for a response.
-		///
-		/// Throws a NNTPException in case of a NNTP-specific error, or a
-		/// NetException in case of a general network communication failure.
+private:
+    void beginPost();
+    void endPost();
 
     std::vector<std::string> multiLineResponse();
+    void multiLineResponse(const std::function<void(std::string_view)>& handler);
+        /// Passes each unstuffed line of a multi-line response to
+        /// the handler; the line is only valid during the call.
+
+    ActiveNewsGroup setNewsGroup(const std::string& newsgroup, const std::string& response, int status);
+        /// Records the group selected by GROUP or LISTGROUP from
+        /// its 211 response.
+
+    void setArticle(std::string_view request);
+        /// Records the current article if request is a number.
+
+    void applySocketOptions();
+
+    void readArticle(NewsArticle& article);
+        /// Reads the text of an ARTICLE response into article.
+
+    void authenticate();
+        /// Sends the credentials given to login().
+
+    void checkInterrupted();
+        /// Drops the connection and throws if the token of the current
+        /// OperationScope has been cancelled or its deadline has passed.
+
+    void waitReadable();
+        /// Waits until the socket can be read, in slices so that the
+        /// deadline and token of the current OperationScope are seen.
+
+    Timespan remainingTime() const;
+        /// Returns the time left until the deadline, which must be set.
+
+    template <typename Operation>
+    auto withReconnect(Operation operation);
+    template <typename Operation, typename Progress>
+    auto withReconnect(Operation operation, Progress progress);
+        /// Runs operation, reconnecting and running it again as
+        /// recover() allows. Attempts are counted anew whenever
+        /// progress() has grown since the last failure.
 
 	std::string  m_host;
+	SocketAddress m_address;
 	DialogSocket m_socket;
 	bool         m_isOpen;
+    ResponseReader m_reader;
+    CommandWriter m_writer;
+    bool m_quickAck{};
+    bool m_noDelay{true};
+    Timespan m_timeout;
+    int m_receiveBufferSize{};
+    int m_sendBufferSize{};
+    int m_reconnectAttempts{};
+    Timespan m_reconnectDelay;
+    LoginHandler m_loginHandler;
+    LoginMethod m_loginMethod{AUTH_NONE};
+    std::string m_username;
+    std::string m_password;
+    std::size_t m_reconnects{};
+    bool m_reconnecting{};
+    std::string m_response; // status line of commands used in tight loops, e.g. stat(), articleTo()
+    std::vector<std::string> m_overviewFormat;
+    Timestamp m_deadline;
+    bool m_hasDeadline{};
+    const CancellationToken* m_token{};
 
     std::string m_newsGroup;
-    using uint_t = unsigned int;
     uint_t m_numArticles{};
     uint_t m_lowArticle{};
     uint_t m_highArticle{};
+    uint_t m_article{};
 };
 
 
@@ -205,6 +591,48 @@ inline const std::string& NNTPClientSession::host() const
 }
 
 
+inline CommandWriter& NNTPClientSession::commandWriter()
+{
+    return m_writer;
+}
+
+
+inline bool NNTPClientSession::getQuickAck() const
+{
+    return m_quickAck;
+}
+
+
+inline bool NNTPClientSession::isOpen() const
+{
+    return m_isOpen;
+}
+
+
+inline const std::string& NNTPClientSession::newsGroup() const
+{
+    return m_newsGroup;
+}
+
+
+inline uint_t NNTPClientSession::currentArticle() const
+{
+    return m_article;
+}
+
+
+inline int NNTPClientSession::getAutoReconnect() const
+{
+    return m_reconnectAttempts;
+}
+
+
+inline std::size_t NNTPClientSession::reconnects() const
+{
+    return m_reconnects;
+}
+
+
 } } // namespace Poco::Net
 
 
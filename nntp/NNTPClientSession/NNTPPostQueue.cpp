@@ -0,0 +1,270 @@
+//
+// NNTPPostQueue.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPPostQueue
+//
+
+
+#include "NNTPPostQueue.h"
+
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+#include "Poco/Net/MailMessage.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Path.h"
+#include "Poco/TemporaryFile.h"
+#include "Poco/Timestamp.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const std::string QUEUE_EXTENSION = "msg";
+
+bool isRejection(const Poco::Exception& exc)
+    // only a complete status line leaves the session ready for its next command
+{
+    const NNTPException* nntp = dynamic_cast<const NNTPException*>(&exc);
+    return nntp && (nntp->code() == 437 || nntp->code() == 440 || nntp->code() == 441);
+}
+
+} // namespace
+
+
+NNTPPostQueue::NNTPPostQueue(const std::string& directory):
+    m_directory(Poco::Path(directory).makeDirectory().toString()),
+    m_failedDirectory(Poco::Path(m_directory).pushDirectory("failed").toString()),
+    m_runnable(*this, &NNTPPostQueue::run),
+    m_retryDelay(DEFAULT_RETRY_DELAY)
+{
+    Poco::File(m_failedDirectory).createDirectories();
+
+    // queue files are named by a zero-padded sequence number,
+    // so name order is posting order
+    std::vector<std::string> names;
+    Poco::File(m_directory).list(names);
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names)
+    {
+        Poco::Path path(m_directory, name);
+        Poco::UInt64 sequence;
+        if (path.getExtension() == QUEUE_EXTENSION && Poco::NumberParser::tryParseUnsigned64(path.getBaseName(), sequence))
+        {
+            m_files.push_back(path.toString());
+            m_nextSequence = std::max(m_nextSequence, sequence + 1);
+        }
+    }
+}
+
+
+NNTPPostQueue::~NNTPPostQueue()
+{
+    try
+    {
+        stop();
+    }
+    catch (...)
+    {
+    }
+}
+
+
+void NNTPPostQueue::enqueue(const NewsArticle& article)
+{
+    Poco::UInt64 sequence;
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        sequence = m_nextSequence++;
+    }
+
+    Poco::Path path(m_directory, Poco::NumberFormatter::format0(sequence, 16));
+    path.setExtension(QUEUE_EXTENSION);
+    const std::string tempPath = Poco::TemporaryFile::tempName(m_directory);
+    try
+    {
+        Poco::FileOutputStream out(tempPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        article.write(out);
+        out.close();
+        if (!out)
+            throw Poco::WriteFileException(tempPath);
+    }
+    catch (...)
+    {
+        // never queue a truncated article, e.g. when the disk is full
+        Poco::File temp(tempPath);
+        if (temp.exists())
+            temp.remove();
+        throw;
+    }
+    Poco::File(tempPath).renameTo(path.toString());
+
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    // keep the queue sorted even if a concurrent enqueue finished first
+    auto pos = std::upper_bound(m_files.begin(), m_files.end(), path.toString());
+    m_files.insert(pos, path.toString());
+    m_queued.signal();
+}
+
+
+std::size_t NNTPPostQueue::size() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_files.size();
+}
+
+
+std::size_t NNTPPostQueue::drain(NNTPClientSession& session, std::size_t maxArticles)
+{
+    Poco::FastMutex::ScopedLock drainLock(m_drainMutex);
+    std::size_t count = 0;
+    while (maxArticles == 0 || count < maxArticles)
+    {
+        std::string path;
+        {
+            Poco::FastMutex::ScopedLock lock(m_mutex);
+            if (m_files.empty())
+                break;
+            path = m_files.front();
+        }
+
+        std::unique_ptr<Poco::FileInputStream> in;
+        try
+        {
+            in.reset(new Poco::FileInputStream(path, std::ios::in | std::ios::binary));
+        }
+        catch (const Poco::FileException&)
+        {
+            // retrying would fail the same way; set the file aside like a rejected article
+            Poco::File file(path);
+            if (file.exists())
+                file.moveTo(m_failedDirectory);
+            takeFront(false);
+            continue;
+        }
+
+        try
+        {
+            session.post(*in);
+        }
+        catch (const NNTPException& bang)
+        {
+            if (bang.code() != 441)
+                throw;
+
+            in.reset();
+            Poco::File(path).moveTo(m_failedDirectory);
+            takeFront(false);
+            continue;
+        }
+        in.reset();
+
+        Poco::File(path).remove();
+        takeFront(true);
+        ++count;
+    }
+    return count;
+}
+
+
+void NNTPPostQueue::takeFront(bool posted)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    m_files.pop_front();
+    if (posted)
+        ++m_posted;
+    else
+        ++m_failed;
+}
+
+
+void NNTPPostQueue::start(NNTPSessionPool& pool)
+{
+    if (m_thread.isRunning())
+        return;
+
+    m_pool = &pool;
+    m_stop = false;
+    m_thread.start(m_runnable);
+}
+
+
+void NNTPPostQueue::stop()
+{
+    if (!m_thread.isRunning())
+        return;
+
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        m_stop = true;
+        m_queued.broadcast();
+    }
+    m_thread.join();
+}
+
+
+void NNTPPostQueue::setRetryDelay(const Poco::Timespan& delay)
+{
+    m_retryDelay = delay;
+}
+
+
+void NNTPPostQueue::run()
+{
+    while (!m_stop)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(m_mutex);
+            while (m_files.empty() && !m_stop)
+                m_queued.wait(m_mutex);
+        }
+        if (m_stop)
+            break;
+
+        try
+        {
+            NNTPSessionPool::Lease session = m_pool->acquire();
+            try
+            {
+                drain(*session);
+            }
+            catch (const Poco::Exception& exc)
+            {
+                // e.g. a timeout or read error in the middle of the article text
+                if (!isRejection(exc))
+                    session.invalidate();
+                throw;
+            }
+            catch (...)
+            {
+                session.invalidate();
+                throw;
+            }
+        }
+        catch (const Poco::Exception&)
+        {
+            // back off, but wake up early when asked to stop
+            Poco::Timestamp failedAt;
+            Poco::FastMutex::ScopedLock lock(m_mutex);
+            while (!m_stop && !failedAt.isElapsed(m_retryDelay.totalMicroseconds()))
+            {
+                long remaining = static_cast<long>((m_retryDelay.totalMicroseconds() - failedAt.elapsed())/1000);
+                m_queued.tryWait(m_mutex, remaining > 0 ? remaining : 1);
+            }
+        }
+    }
+}
+
+
+} } // namespace Poco::Net
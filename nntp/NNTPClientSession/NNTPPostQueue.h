@@ -0,0 +1,133 @@
+//
+// NNTPPostQueue.h
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPPostQueue
+//
+// Definition of the NNTPPostQueue class.
+//
+
+
+#ifndef Net_NNTPPostQueue_INCLUDED
+#define Net_NNTPPostQueue_INCLUDED
+
+
+#include "NNTPClientSession.h"
+#include "NNTPSessionPool.h"
+
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/RunnableAdapter.h"
+#include "Poco/Thread.h"
+#include "Poco/Timespan.h"
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <string>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API NNTPPostQueue
+    /// A persistent queue of outbound articles.
+    ///
+    /// Every enqueued article is written to its own file in the
+    /// queue directory before enqueue() returns, so queued posts
+    /// survive restarts. Articles are posted in order, either by
+    /// calling drain() with an open session, or by a background
+    /// thread that drains the queue over a pooled, already
+    /// connected session whenever new articles arrive.
+    ///
+    /// Articles the server rejects permanently (441), and queue
+    /// files that can no longer be opened, are moved to the "failed"
+    /// subdirectory of the queue directory.
+{
+public:
+    explicit NNTPPostQueue(const std::string& directory);
+        /// Creates the queue, picking up articles left in the
+        /// directory by a previous run.
+
+    ~NNTPPostQueue();
+        /// Stops the background thread, if running.
+
+    void enqueue(const NewsArticle& article);
+        /// Writes the article to the queue directory and
+        /// wakes up the background thread.
+
+    std::size_t size() const;
+        /// Returns the number of queued articles.
+
+    std::size_t drain(NNTPClientSession& session, std::size_t maxArticles = 0);
+        /// Posts up to maxArticles queued articles (all if 0) over
+        /// the given session and returns the number posted.
+        ///
+        /// Throws a NNTPException if the server refuses posting
+        /// altogether, or a NetException in case of a network
+        /// failure; the article being posted stays queued.
+
+    void start(NNTPSessionPool& pool);
+        /// Starts a background thread that posts queued
+        /// articles over sessions leased from the given pool.
+
+    void stop();
+        /// Stops the background thread. Queued articles stay
+        /// on disk.
+
+    void setRetryDelay(const Poco::Timespan& delay);
+        /// Sets how long the background thread waits after
+        /// a failed attempt before it tries again.
+
+    std::size_t posted() const;
+        /// Returns the number of articles posted successfully.
+
+    std::size_t failed() const;
+        /// Returns the number of articles rejected by the server
+        /// or set aside as unreadable.
+
+private:
+    enum
+    {
+        DEFAULT_RETRY_DELAY = 30000000 // 30 seconds between attempts after a failure
+    };
+
+    void run();
+    void takeFront(bool posted);
+
+    std::string m_directory;
+    std::string m_failedDirectory;
+    std::deque<std::string> m_files;
+    Poco::UInt64 m_nextSequence{};
+    mutable Poco::FastMutex m_mutex;
+    Poco::FastMutex m_drainMutex;
+    Poco::Condition m_queued;
+    NNTPSessionPool* m_pool{};
+    Poco::Thread m_thread;
+    Poco::RunnableAdapter<NNTPPostQueue> m_runnable;
+    std::atomic<bool> m_stop{false};
+    Poco::Timespan m_retryDelay;
+    std::atomic<std::size_t> m_posted{0};
+    std::atomic<std::size_t> m_failed{0};
+};
+
+
+//
+// inlines
+//
+inline std::size_t NNTPPostQueue::posted() const
+{
+    return m_posted;
+}
+
+
+inline std::size_t NNTPPostQueue::failed() const
+{
+    return m_failed;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_NNTPPostQueue_INCLUDED
@@ -0,0 +1,287 @@
+//
+// NNTPServerGroup.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPServerGroup
+//
+
+
+#include "NNTPServerGroup.h"
+
+#include "Poco/Exception.h"
+#include "Poco/Thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const double LATENCY_SMOOTHING = 0.2;
+const double INITIAL_LATENCY_MS = 100.0;
+const Poco::Timestamp::TimeDiff MIN_BACKOFF = Poco::Timestamp::TimeDiff(1000000);    // 1 second
+const Poco::Timestamp::TimeDiff MAX_BACKOFF = Poco::Timestamp::TimeDiff(300000000);  // 5 minutes
+const long ACQUIRE_TIMEOUT = 30000; // milliseconds to wait for a free connection
+
+} // namespace
+
+
+struct NNTPServerGroup::ServerState
+{
+    explicit ServerState(const Server& config):
+        server(config),
+        pool(config.host, config.port, config.maxConnections)
+    {
+        pool.setLogin(config.loginMethod, config.username, config.password);
+    }
+
+    Server server;
+    NNTPSessionPool pool;
+    double latency{INITIAL_LATENCY_MS};
+    std::size_t inFlight{};
+    std::size_t fetched{};
+    std::size_t missing{};
+    std::size_t failures{};
+    std::size_t consecutiveFailures{};
+    Poco::Timestamp downUntil{0};
+};
+
+
+NNTPServerGroup::NNTPServerGroup()
+{
+    m_random.seed();
+}
+
+
+NNTPServerGroup::~NNTPServerGroup()
+{
+}
+
+
+void NNTPServerGroup::addServer(const Server& server)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    m_servers.push_back(std::unique_ptr<ServerState>(new ServerState(server)));
+}
+
+
+std::vector<std::string> NNTPServerGroup::articleRaw(const std::string& messageId)
+{
+    std::unique_ptr<Poco::Exception> lastError;
+    for (ServerState* state : candidates())
+    {
+        started(*state);
+        Poco::Timestamp start;
+        try
+        {
+            NNTPSessionPool::Lease session = state->pool.acquire(ACQUIRE_TIMEOUT);
+            std::vector<std::string> lines;
+            try
+            {
+                lines = session->articleRaw(messageId);
+            }
+            catch (const Poco::Exception& bang)
+            {
+                // only a 430 leaves the connection in a known state
+                const NNTPException* refusal = dynamic_cast<const NNTPException*>(&bang);
+                if (!refusal || refusal->code() != 430)
+                    session.invalidate();
+                throw;
+            }
+            succeeded(*state, start.elapsed());
+            return lines;
+        }
+        catch (const NNTPPoolExhaustedException& bang)
+        {
+            finished(*state); // connection quota exhausted; not the server's fault
+            lastError.reset(bang.clone());
+        }
+        catch (const NNTPException& bang)
+        {
+            if (bang.code() == 430)
+            {
+                missed(*state);
+                continue;
+            }
+            failed(*state);
+            lastError.reset(bang.clone());
+        }
+        catch (const NetException& bang)
+        {
+            failed(*state);
+            lastError.reset(bang.clone());
+        }
+        catch (const Poco::TimeoutException& bang)
+        {
+            failed(*state);
+            lastError.reset(bang.clone());
+        }
+    }
+
+    if (lastError)
+        lastError->rethrow();
+    throw NNTPException("No such article", messageId, 430);
+}
+
+
+std::vector<std::string> NNTPServerGroup::fetch(const std::vector<std::string>& messageIds, std::size_t parallelism, const ArticleHandler& handler)
+{
+    std::atomic<std::size_t> next{0};
+    std::vector<std::string> missing;
+    Poco::FastMutex missingMutex;
+
+    auto worker = [&]()
+    {
+        for (std::size_t i = next++; i < messageIds.size(); i = next++)
+        {
+            try
+            {
+                std::vector<std::string> lines = articleRaw(messageIds[i]);
+                handler(messageIds[i], lines);
+            }
+            catch (const Poco::Exception&)
+            {
+                Poco::FastMutex::ScopedLock lock(missingMutex);
+                missing.push_back(messageIds[i]);
+            }
+        }
+    };
+
+    parallelism = std::max<std::size_t>(1, std::min(parallelism, messageIds.size()));
+    std::vector<std::unique_ptr<Poco::Thread>> threads;
+    for (std::size_t i = 1; i < parallelism; ++i)
+    {
+        threads.emplace_back(new Poco::Thread);
+        threads.back()->startFunc(worker);
+    }
+    worker();
+    for (const std::unique_ptr<Poco::Thread>& thread : threads)
+        thread->join();
+
+    return missing;
+}
+
+
+std::vector<NNTPServerGroup::ServerStatus> NNTPServerGroup::status() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    Poco::Timestamp now;
+    std::vector<ServerStatus> result;
+    for (const std::unique_ptr<ServerState>& state : m_servers)
+    {
+        ServerStatus status;
+        status.server = state->server;
+        status.available = state->downUntil <= now;
+        status.latencyMilliseconds = state->latency;
+        status.inFlight = state->inFlight;
+        status.fetched = state->fetched;
+        status.missing = state->missing;
+        status.failures = state->failures;
+        result.push_back(status);
+    }
+    return result;
+}
+
+
+std::vector<NNTPServerGroup::ServerState*> NNTPServerGroup::candidates()
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    Poco::Timestamp now;
+    std::map<int, std::vector<ServerState*>> tiers;
+    std::vector<ServerState*> down;
+    for (const std::unique_ptr<ServerState>& state : m_servers)
+    {
+        if (state->downUntil <= now)
+            tiers[state->server.tier].push_back(state.get());
+        else
+            down.push_back(state.get());
+    }
+
+    // within a tier, draw servers without replacement, each with a
+    // probability inversely proportional to its latency and load
+    std::vector<ServerState*> order;
+    for (auto& tier : tiers)
+    {
+        std::vector<ServerState*>& servers = tier.second;
+        while (!servers.empty())
+        {
+            std::vector<double> weights;
+            double total = 0;
+            for (ServerState* state : servers)
+            {
+                const double load = 1.0 + static_cast<double>(state->inFlight)/static_cast<double>(state->server.maxConnections);
+                weights.push_back(1.0/(state->latency*load));
+                total += weights.back();
+            }
+            double pick = m_random.nextDouble()*total;
+            std::size_t chosen = 0;
+            while (chosen + 1 < servers.size() && pick >= weights[chosen])
+                pick -= weights[chosen++];
+            order.push_back(servers[chosen]);
+            servers.erase(servers.begin() + static_cast<std::ptrdiff_t>(chosen));
+        }
+    }
+
+    // servers in back-off are still tried as a last resort
+    std::sort(down.begin(), down.end(), [](const ServerState* lhs, const ServerState* rhs) { return lhs->downUntil < rhs->downUntil; });
+    order.insert(order.end(), down.begin(), down.end());
+
+    return order;
+}
+
+
+void NNTPServerGroup::started(ServerState& state)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    ++state.inFlight;
+}
+
+
+void NNTPServerGroup::finished(ServerState& state)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    --state.inFlight;
+}
+
+
+void NNTPServerGroup::succeeded(ServerState& state, Poco::Timestamp::TimeDiff elapsed)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    --state.inFlight;
+    state.latency += LATENCY_SMOOTHING*(static_cast<double>(elapsed)/1000.0 - state.latency);
+    state.consecutiveFailures = 0;
+    state.downUntil = Poco::Timestamp(0);
+    ++state.fetched;
+}
+
+
+void NNTPServerGroup::missed(ServerState& state)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    --state.inFlight;
+    state.consecutiveFailures = 0;
+    ++state.missing;
+}
+
+
+void NNTPServerGroup::failed(ServerState& state)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    --state.inFlight;
+    ++state.failures;
+    ++state.consecutiveFailures;
+    Poco::Timestamp::TimeDiff backoff = MIN_BACKOFF;
+    for (std::size_t i = 1; i < state.consecutiveFailures && backoff < MAX_BACKOFF; ++i)
+        backoff *= 2;
+    state.downUntil = Poco::Timestamp() + std::min(backoff, MAX_BACKOFF);
+}
+
+
+} } // namespace Poco::Net
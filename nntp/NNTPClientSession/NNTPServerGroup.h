@@ -0,0 +1,114 @@
+//
+// NNTPServerGroup.h
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPServerGroup
+//
+// Definition of the NNTPServerGroup class.
+//
+
+
+#ifndef Net_NNTPServerGroup_INCLUDED
+#define Net_NNTPServerGroup_INCLUDED
+
+
+#include "NNTPClientSession.h"
+#include "NNTPSessionPool.h"
+
+#include "Poco/Mutex.h"
+#include "Poco/Random.h"
+#include "Poco/Timestamp.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API NNTPServerGroup
+    /// A group of news servers that are used together, typically
+    /// a primary provider plus backup block accounts.
+    ///
+    /// Each server has its own pool of sessions limited by its
+    /// connection quota. Articles are fetched by message-id from
+    /// the lowest tier first; within a tier, servers are chosen at
+    /// random weighted by their recent response latency and load.
+    /// An article the chosen server does not have (430) is retried
+    /// on the remaining servers, so backups fill in what the primary
+    /// is missing. Servers that fail at the network level are taken
+    /// out of rotation for an exponentially growing period.
+    ///
+    /// Servers must be added before the group is used; fetching is
+    /// thread-safe.
+{
+public:
+    struct Server
+    {
+        std::string host;
+        Poco::UInt16 port{NNTPClientSession::NNTP_PORT};
+        std::size_t maxConnections{4};
+        int tier{};
+            /// Servers of lower tiers are asked first.
+        NNTPClientSession::LoginMethod loginMethod{NNTPClientSession::AUTH_NONE};
+        std::string username;
+        std::string password;
+            /// Credentials of the account, if the server requires them.
+    };
+
+    struct ServerStatus
+    {
+        Server server;
+        bool available{};
+        double latencyMilliseconds{};
+        std::size_t inFlight{};
+        std::size_t fetched{};
+        std::size_t missing{};
+        std::size_t failures{};
+    };
+
+    using ArticleHandler = std::function<void(const std::string& messageId, std::vector<std::string>& lines)>;
+
+    NNTPServerGroup();
+    ~NNTPServerGroup();
+
+    void addServer(const Server& server);
+
+    std::vector<std::string> articleRaw(const std::string& messageId);
+        /// Fetches the article from the first server that has it.
+        ///
+        /// Throws a NNTPException with status 430 if no reachable
+        /// server has the article, or the last network exception if
+        /// no server could be reached at all.
+
+    std::vector<std::string> fetch(const std::vector<std::string>& messageIds, std::size_t parallelism, const ArticleHandler& handler);
+        /// Fetches the given articles using up to parallelism
+        /// concurrent requests and passes each one to the handler,
+        /// which may be called from several threads at once.
+        /// Returns the message-ids that no server could supply.
+
+    std::vector<ServerStatus> status() const;
+
+private:
+    struct ServerState;
+
+    std::vector<ServerState*> candidates();
+    void started(ServerState& state);
+    void finished(ServerState& state);
+    void succeeded(ServerState& state, Poco::Timestamp::TimeDiff elapsed);
+    void missed(ServerState& state);
+    void failed(ServerState& state);
+
+    std::vector<std::unique_ptr<ServerState>> m_servers;
+    mutable Poco::FastMutex m_mutex;
+    Poco::Random m_random;
+};
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_NNTPServerGroup_INCLUDED
@@ -0,0 +1,216 @@
+//
+// NNTPSessionPool.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPSessionPool
+//
+
+
+#include "NNTPSessionPool.h"
+
+#include "Poco/Timestamp.h"
+
+#include <utility>
+
+
+namespace Poco {
+namespace Net {
+
+
+NNTPSessionPool::Lease::Lease(NNTPSessionPool& pool, std::unique_ptr<NNTPClientSession> session):
+    m_pool(&pool),
+    m_session(std::move(session)),
+    m_valid(true)
+{
+}
+
+
+NNTPSessionPool::Lease::Lease(Lease&& rhs) noexcept:
+    m_pool(rhs.m_pool),
+    m_session(std::move(rhs.m_session)),
+    m_valid(rhs.m_valid)
+{
+    rhs.m_pool = nullptr;
+}
+
+
+NNTPSessionPool::Lease::~Lease()
+{
+    if (m_pool && m_session)
+        m_pool->release(std::move(m_session), m_valid);
+}
+
+
+void NNTPSessionPool::Lease::invalidate()
+{
+    m_valid = false;
+}
+
+
+NNTPSessionPool::NNTPSessionPool(const std::string& host, Poco::UInt16 port, std::size_t maxSessions):
+    m_host(host),
+    m_port(port),
+    m_maxSessions(maxSessions > 0 ? maxSessions : 1)
+{
+}
+
+
+NNTPSessionPool::~NNTPSessionPool()
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    m_idle.clear();
+}
+
+
+NNTPSessionPool::Lease NNTPSessionPool::acquire(long timeoutMilliseconds)
+{
+    Poco::Timestamp start;
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        while (m_idle.empty() && m_allocated >= m_maxSessions)
+        {
+            long remaining = timeoutMilliseconds - static_cast<long>(start.elapsed()/1000);
+            if (remaining <= 0 || !m_available.tryWait(m_mutex, remaining))
+                throw NNTPPoolExhaustedException("No session available for " + m_host);
+        }
+        if (!m_idle.empty())
+        {
+            std::unique_ptr<NNTPClientSession> session = std::move(m_idle.back().session);
+            m_idle.pop_back();
+            return Lease(*this, std::move(session));
+        }
+        ++m_allocated;
+    }
+
+    // connect outside the lock; other threads may use idle sessions meanwhile
+    return Lease(*this, openSession());
+}
+
+
+void NNTPSessionPool::setLogin(NNTPClientSession::LoginMethod loginMethod, const std::string& username, const std::string& password)
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    m_loginMethod = loginMethod;
+    m_username = username;
+    m_password = password;
+}
+
+
+void NNTPSessionPool::prewarm(std::size_t count)
+{
+    for (;;)
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(m_mutex);
+            if (m_idle.size() >= count || m_allocated >= m_maxSessions)
+                return;
+            ++m_allocated;
+        }
+        release(openSession(), true);
+    }
+}
+
+
+std::size_t NNTPSessionPool::keepAlive(const Timespan& idleTime)
+{
+    // take the stale sessions out, so that the check runs outside the lock
+    std::vector<std::unique_ptr<NNTPClientSession>> stale;
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        for (auto it = m_idle.begin(); it != m_idle.end();)
+        {
+            if (it->since.isElapsed(idleTime.totalMicroseconds()))
+            {
+                stale.push_back(std::move(it->session));
+                it = m_idle.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    std::size_t dropped = 0;
+    for (std::unique_ptr<NNTPClientSession>& session : stale)
+    {
+        bool valid = true;
+        try
+        {
+            session->date();
+        }
+        catch (const Poco::Exception&)
+        {
+            valid = false;
+            ++dropped;
+        }
+        release(std::move(session), valid);
+    }
+    return dropped;
+}
+
+
+std::size_t NNTPSessionPool::idle() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_idle.size();
+}
+
+
+std::size_t NNTPSessionPool::allocated() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_allocated;
+}
+
+
+std::unique_ptr<NNTPClientSession> NNTPSessionPool::createSession()
+{
+    std::unique_ptr<NNTPClientSession> session(new NNTPClientSession(m_host, m_port));
+    session->login(m_loginMethod, m_username, m_password);
+    return session;
+}
+
+
+std::unique_ptr<NNTPClientSession> NNTPSessionPool::openSession()
+{
+    try
+    {
+        return createSession();
+    }
+    catch (...)
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        --m_allocated;
+        m_available.signal();
+        throw;
+    }
+}
+
+
+void NNTPSessionPool::release(std::unique_ptr<NNTPClientSession> session, bool valid)
+{
+    if (!valid)
+    {
+        try
+        {
+            session->abort();
+        }
+        catch (...)
+        {
+        }
+        session.reset();
+    }
+
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    if (session)
+        m_idle.push_back(IdleSession{std::move(session), Poco::Timestamp()});
+    else
+        --m_allocated;
+    m_available.signal();
+}
+
+
+POCO_IMPLEMENT_EXCEPTION(NNTPPoolExhaustedException, NNTPException, "No NNTP session available")
+
+
+} } // namespace Poco::Net
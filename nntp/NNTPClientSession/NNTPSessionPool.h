@@ -0,0 +1,194 @@
+//
+// NNTPSessionPool.h
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPSessionPool
+//
+// Definition of the NNTPSessionPool class.
+//
+
+
+#ifndef Net_NNTPSessionPool_INCLUDED
+#define Net_NNTPSessionPool_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Timespan.h"
+#include "Poco/Timestamp.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+POCO_DECLARE_EXCEPTION(NNTP_API, NNTPPoolExhaustedException, NNTPException)
+
+class NNTP_API NNTPSessionPool
+    /// A thread-safe pool of open NNTPClientSession objects
+    /// connected to a single server.
+    ///
+    /// Sessions are created lazily up to the configured maximum
+    /// and handed out as Lease objects, which return the session
+    /// to the pool when they go out of scope.
+    ///
+    /// Each new session costs a connect, the greeting and, with
+    /// credentials, the authentication: three round trips or more
+    /// before the first command. To keep bursts of work from paying
+    /// that, prewarm() opens sessions ahead of time, and keepAlive(),
+    /// called periodically, keeps idle sessions from being dropped by
+    /// the server's idle timeout.
+{
+public:
+    class Lease
+        /// Exclusive use of a pooled session.
+        ///
+        /// If the session has failed in a way that leaves the
+        /// connection in an unknown state, call invalidate()
+        /// so that it is dropped instead of being reused.
+    {
+    public:
+        Lease(Lease&& rhs) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        NNTPClientSession& operator*() const;
+        NNTPClientSession* operator->() const;
+
+        void invalidate();
+            /// Closes the session and discards it when the lease ends.
+
+    private:
+        Lease(NNTPSessionPool& pool, std::unique_ptr<NNTPClientSession> session);
+
+        NNTPSessionPool* m_pool;
+        std::unique_ptr<NNTPClientSession> m_session;
+        bool m_valid;
+
+        friend class NNTPSessionPool;
+    };
+
+    NNTPSessionPool(const std::string& host, Poco::UInt16 port = NNTPClientSession::NNTP_PORT, std::size_t maxSessions = 4);
+        /// Creates a pool that opens at most maxSessions
+        /// concurrent sessions to the given server.
+
+    ~NNTPSessionPool();
+        /// Closes all idle sessions.
+
+    Lease acquire(long timeoutMilliseconds = 30000);
+        /// Returns an idle session, opens a new one if the
+        /// pool is below its limit, or waits for a session
+        /// to be returned.
+        ///
+        /// Throws a NNTPPoolExhaustedException if no session
+        /// becomes available within the given timeout.
+
+    void setLogin(NNTPClientSession::LoginMethod loginMethod, const std::string& username, const std::string& password);
+        /// Sets the credentials with which new sessions log in; see
+        /// NNTPClientSession::login(). Must be called before any
+        /// session is opened.
+
+    void prewarm(std::size_t count);
+        /// Opens new sessions until at least count of them are idle,
+        /// or the pool has reached its limit, so that the following
+        /// acquire() calls need not connect.
+        ///
+        /// Throws if a session cannot be opened.
+
+    std::size_t keepAlive(const Timespan& idleTime);
+        /// Sends a DATE command on each idle session that has not
+        /// been used for idleTime, and drops those that fail. Returns
+        /// the number of sessions dropped; prewarm() may replace them.
+        ///
+        /// Meant to be called periodically, with an idleTime well
+        /// below the server's idle timeout (often a few minutes).
+        /// Sessions being checked are not available to acquire(),
+        /// which waits for them if the pool is at its limit.
+
+    const std::string& host() const;
+    Poco::UInt16 port() const;
+    std::size_t maxSessions() const;
+
+    std::size_t idle() const;
+        /// Returns the number of open sessions that are not leased.
+
+    std::size_t allocated() const;
+        /// Returns the number of open sessions, leased or idle.
+
+protected:
+    virtual std::unique_ptr<NNTPClientSession> createSession();
+        /// Connects a new session, reads the server greeting and logs
+        /// in with the credentials set through setLogin(), if any.
+        /// Override to perform other authentication or mode switches.
+
+private:
+    struct IdleSession
+    {
+        std::unique_ptr<NNTPClientSession> session;
+        Poco::Timestamp since;
+    };
+
+    std::unique_ptr<NNTPClientSession> openSession();
+        /// Calls createSession() for a session already counted as
+        /// allocated, and uncounts it if that fails.
+
+    void release(std::unique_ptr<NNTPClientSession> session, bool valid);
+
+    std::string m_host;
+    Poco::UInt16 m_port;
+    std::size_t m_maxSessions;
+    NNTPClientSession::LoginMethod m_loginMethod{NNTPClientSession::AUTH_NONE};
+    std::string m_username;
+    std::string m_password;
+    std::size_t m_allocated{};
+    std::vector<IdleSession> m_idle; // most recently used last
+    mutable Poco::FastMutex m_mutex;
+    Poco::Condition m_available;
+};
+
+
+//
+// inlines
+//
+inline NNTPClientSession& NNTPSessionPool::Lease::operator*() const
+{
+    return *m_session;
+}
+
+
+inline NNTPClientSession* NNTPSessionPool::Lease::operator->() const
+{
+    return m_session.get();
+}
+
+
+inline const std::string& NNTPSessionPool::host() const
+{
+    return m_host;
+}
+
+
+inline Poco::UInt16 NNTPSessionPool::port() const
+{
+    return m_port;
+}
+
+
+inline std::size_t NNTPSessionPool::maxSessions() const
+{
+    return m_maxSessions;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_NNTPSessionPool_INCLUDED
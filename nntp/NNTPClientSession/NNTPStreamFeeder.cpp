@@ -0,0 +1,302 @@
+//
+// NNTPStreamFeeder.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPStreamFeeder
+//
+
+
+#include "NNTPStreamFeeder.h"
+#include "CommandLine.h"
+#include "StatusLine.h"
+
+#include "Poco/Net/MailStream.h"
+#include "Poco/Net/SocketStream.h"
+
+#include <utility>
+
+
+namespace Poco {
+namespace Net {
+
+
+NNTPStreamFeeder::NNTPStreamFeeder(const StreamSocket& socket):
+    NNTPClientSession(socket),
+    m_window(DEFAULT_WINDOW),
+    m_retryDelay(DEFAULT_RETRY_DELAY),
+    m_maxAttempts(DEFAULT_MAX_ATTEMPTS)
+{
+}
+
+
+NNTPStreamFeeder::NNTPStreamFeeder(const std::string& host, Poco::UInt16 port):
+    NNTPClientSession(host, port),
+    m_window(DEFAULT_WINDOW),
+    m_retryDelay(DEFAULT_RETRY_DELAY),
+    m_maxAttempts(DEFAULT_MAX_ATTEMPTS)
+{
+}
+
+
+NNTPStreamFeeder::~NNTPStreamFeeder()
+{
+}
+
+
+bool NNTPStreamFeeder::modeStream()
+{
+    std::string response;
+    int status = sendCommand(CommandLine(CommandLine::MODE_STREAM), response);
+    m_streaming = status == 203;
+    return m_streaming;
+}
+
+
+void NNTPStreamFeeder::setWindow(std::size_t window)
+{
+    m_window = window > 0 ? window : 1;
+}
+
+
+void NNTPStreamFeeder::setRetryDelay(const Poco::Timespan& delay)
+{
+    m_retryDelay = delay;
+}
+
+
+void NNTPStreamFeeder::setMaxAttempts(int attempts)
+{
+    m_maxAttempts = attempts > 0 ? attempts : 1;
+}
+
+
+void NNTPStreamFeeder::setResultCallback(const ResultCallback& callback)
+{
+    m_callback = callback;
+}
+
+
+void NNTPStreamFeeder::offer(const std::string& messageId, const Article& article)
+{
+    ++m_statistics.offered;
+    m_ready.push_back(Offer{messageId, article, 0, Poco::Timestamp()});
+    resume([this]() { pump(); });
+}
+
+
+void NNTPStreamFeeder::flush()
+{
+    resume([this]()
+        {
+            while (pending() > 0)
+            {
+                pump();
+                if (!m_inFlight.empty())
+                {
+                    receiveResponse();
+                }
+                else if (m_ready.empty() && !m_deferred.empty())
+                {
+                    // nothing left to do but wait for the next deferral to expire
+                    pause(Poco::Timespan(m_deferred.front().due - Poco::Timestamp()));
+                }
+            }
+        });
+}
+
+
+void NNTPStreamFeeder::resume(const std::function<void()>& step)
+{
+    std::size_t answered = m_answered;
+    bool reconnected = false;
+    for (int attempt = 1;;)
+    {
+        try
+        {
+            if (reconnected && m_streaming && !modeStream())
+                throw NNTPException("Streaming refused after reconnect");
+            step();
+            return;
+        }
+        catch (const Poco::Exception& exc)
+        {
+            // only failures in a row count against the limit
+            if (m_answered != answered)
+            {
+                answered = m_answered;
+                attempt = 1;
+            }
+            if (!recover(exc, attempt))
+                throw;
+        }
+        reconnected = true;
+
+        // commands in flight were lost with the connection; offer them again, in order
+        while (!m_inFlight.empty())
+        {
+            InFlight& command = m_inFlight.back();
+            if (command.command == CMD_CHECK)
+                --command.offer.attempts;
+            m_ready.push_front(std::move(command.offer));
+            m_inFlight.pop_back();
+        }
+    }
+}
+
+
+void NNTPStreamFeeder::pump()
+{
+    promoteDeferred();
+    while (!m_ready.empty())
+    {
+        if (m_inFlight.size() >= m_window)
+        {
+            receiveResponse();
+        }
+        else
+        {
+            Offer offer = std::move(m_ready.front());
+            m_ready.pop_front();
+            sendCheck(std::move(offer));
+        }
+
+        // handle responses that have already arrived, so that
+        // TAKETHIS follows its 238 as soon as possible
+        while (!m_inFlight.empty() && responseReady())
+            receiveResponse();
+    }
+
+    // send the burst of commands queued above in one write
+    commandWriter().flush();
+}
+
+
+void NNTPStreamFeeder::sendCheck(Offer offer)
+{
+    ++offer.attempts;
+    sendCommand(CommandLine(CommandLine::CHECK).arg(offer.messageId));
+    m_inFlight.push_back(InFlight{CMD_CHECK, std::move(offer)});
+}
+
+
+void NNTPStreamFeeder::sendTakeThis(Offer offer)
+{
+    const std::string& article = *offer.article;
+    if (isEncoded(article))
+    {
+        // the article goes out as it is, from memory kept alive by
+        // m_inFlight until the peer has answered
+        sendCommand(CommandLine(CommandLine::TAKETHIS).arg(offer.messageId));
+        commandWriter().reference(article);
+        commandWriter().write(article.empty() || article.back() == '\n' ? ".\r\n" : "\r\n.\r\n");
+    }
+    else
+    {
+        commandWriter().flush();
+        SocketOutputStream socketStream(socket());
+        socketStream << "TAKETHIS " << offer.messageId << "\r\n";
+        MailOutputStream mailStream(socketStream);
+        mailStream.write(article.data(), static_cast<std::streamsize>(article.size()));
+        mailStream.close();
+        socketStream.flush();
+    }
+    m_inFlight.push_back(InFlight{CMD_TAKETHIS, std::move(offer)});
+}
+
+
+bool NNTPStreamFeeder::isEncoded(const std::string& article)
+{
+    // CRLF line endings throughout and no line starting with a dot
+    if (!article.empty() && article.front() == '.')
+        return false;
+    const char* p = article.data();
+    const char* const end = p + article.size();
+    while ((p = ResponseReader::findLineFeed(p, end)) != end)
+    {
+        if (p == article.data() || p[-1] != '\r' || (p + 1 != end && p[1] == '.'))
+            return false;
+        ++p;
+    }
+    return true;
+}
+
+
+void NNTPStreamFeeder::receiveResponse()
+{
+    std::string response;
+    int status = receiveStatus(response);
+    if (m_inFlight.empty())
+        throw NNTPException("Unexpected streaming response", response, status);
+
+    InFlight command = std::move(m_inFlight.front());
+    m_inFlight.pop_front();
+    ++m_answered;
+
+    // 238 <message-id>
+    if (StatusLine(response)[1] != command.offer.messageId)
+        throw NNTPException("Streaming response does not match command", response, status);
+
+    if (command.command == CMD_CHECK)
+    {
+        switch (status)
+        {
+        case 238:
+            sendTakeThis(std::move(command.offer));
+            return;
+        case 431:
+            if (command.offer.attempts < m_maxAttempts)
+            {
+                ++m_statistics.retried;
+                command.offer.due = Poco::Timestamp() + m_retryDelay.totalMicroseconds();
+                m_deferred.push_back(std::move(command.offer));
+            }
+            else
+            {
+                ++m_statistics.deferred;
+                finish(command.offer.messageId, FEED_DEFERRED);
+            }
+            return;
+        case 438:
+            ++m_statistics.notWanted;
+            finish(command.offer.messageId, FEED_NOT_WANTED);
+            return;
+        }
+    }
+    else
+    {
+        switch (status)
+        {
+        case 239:
+            ++m_statistics.accepted;
+            finish(command.offer.messageId, FEED_ACCEPTED);
+            return;
+        case 439:
+            ++m_statistics.rejected;
+            finish(command.offer.messageId, FEED_REJECTED);
+            return;
+        }
+    }
+    throw NNTPException("Unexpected streaming response", response, status);
+}
+
+
+void NNTPStreamFeeder::promoteDeferred()
+{
+    Poco::Timestamp now;
+    while (!m_deferred.empty() && m_deferred.front().due <= now)
+    {
+        m_ready.push_back(std::move(m_deferred.front()));
+        m_deferred.pop_front();
+    }
+}
+
+
+void NNTPStreamFeeder::finish(const std::string& messageId, Result result)
+{
+    if (m_callback)
+        m_callback(messageId, result);
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,217 @@
+//
+// NNTPStreamFeeder.h
+//
+// Library: Net
+// Package: Mail
+// Module:  NNTPStreamFeeder
+//
+// Definition of the NNTPStreamFeeder class.
+//
+
+
+#ifndef Net_NNTPStreamFeeder_INCLUDED
+#define Net_NNTPStreamFeeder_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include "Poco/Timespan.h"
+#include "Poco/Timestamp.h"
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API NNTPStreamFeeder: public NNTPClientSession
+    /// This class implements the transit side of the NNTP
+    /// streaming extension (MODE STREAM, CHECK and TAKETHIS,
+    /// RFC 4644) for feeding articles to a peer.
+    ///
+    /// Offered articles are pipelined: up to window() CHECK and
+    /// TAKETHIS commands are outstanding at any time, and responses
+    /// are matched to commands in the order they arrive. Articles
+    /// the peer asks to resend later (431) are retried after
+    /// retryDelay(), up to maxAttempts() times.
+    ///
+    /// Articles are passed as unstuffed text; dot-stuffing and line
+    /// terminators are applied while sending. Commands are coalesced
+    /// and sent in one write per burst, and articles that need no
+    /// stuffing (CRLF line endings, no line starting with a dot) are
+    /// sent straight from memory along with their TAKETHIS line.
+    ///
+    /// With automatic reconnects enabled (see setAutoReconnect()),
+    /// a lost connection is replaced, streaming mode is requested
+    /// again, and the commands that were in flight are sent again.
+{
+public:
+    using Article = std::shared_ptr<const std::string>;
+
+    enum Result
+    {
+        FEED_ACCEPTED,    /// 239: the peer took the article
+        FEED_REJECTED,    /// 439: the peer received but rejected the article
+        FEED_NOT_WANTED,  /// 438: the peer already has or does not want it
+        FEED_DEFERRED     /// 431: still deferred after the last attempt
+    };
+
+    using ResultCallback = std::function<void(const std::string& messageId, Result result)>;
+
+    struct Statistics
+    {
+        std::size_t offered{};
+        std::size_t accepted{};
+        std::size_t rejected{};
+        std::size_t notWanted{};
+        std::size_t deferred{};
+        std::size_t retried{};
+    };
+
+    explicit NNTPStreamFeeder(const StreamSocket& socket);
+        /// Creates the NNTPStreamFeeder using the given socket,
+        /// which must be connected to a NNTP server.
+
+    NNTPStreamFeeder(const std::string& host, Poco::UInt16 port = NNTP_PORT);
+        /// Creates the NNTPStreamFeeder using a socket connected
+        /// to the given host and port.
+
+    ~NNTPStreamFeeder() override;
+
+    bool modeStream();
+        /// Sends MODE STREAM and returns true if the server
+        /// switched to streaming mode (203).
+
+    void setWindow(std::size_t window);
+        /// Sets the maximum number of outstanding commands.
+
+    std::size_t window() const;
+
+    void setRetryDelay(const Poco::Timespan& delay);
+        /// Sets how long deferred (431) articles wait before
+        /// they are offered again.
+
+    Poco::Timespan retryDelay() const;
+
+    void setMaxAttempts(int attempts);
+        /// Sets how often an article is offered before it is
+        /// reported as FEED_DEFERRED.
+
+    int maxAttempts() const;
+
+    void setResultCallback(const ResultCallback& callback);
+        /// Sets the function called with the final outcome
+        /// of every offered article.
+
+    void offer(const std::string& messageId, const Article& article);
+        /// Queues the article and sends as many commands as the
+        /// window allows, reading responses as needed.
+        ///
+        /// Throws a NNTPException if the server answers with an
+        /// unexpected status, or a NetException in case of a
+        /// general network communication failure.
+
+    void flush();
+        /// Sends all queued articles and waits until every
+        /// outstanding command, including deferred retries,
+        /// has been answered.
+
+    std::size_t pending() const;
+        /// Returns the number of articles that are queued,
+        /// in flight or waiting for a retry.
+
+    const Statistics& statistics() const;
+
+private:
+    enum
+    {
+        DEFAULT_WINDOW       = 128,
+        DEFAULT_RETRY_DELAY  = 10000000, // 10 seconds before a deferred article is offered again
+        DEFAULT_MAX_ATTEMPTS = 3
+    };
+
+    enum Command
+    {
+        CMD_CHECK,
+        CMD_TAKETHIS
+    };
+
+    struct Offer
+    {
+        std::string messageId;
+        Article article;
+        int attempts{};
+        Poco::Timestamp due;
+    };
+
+    struct InFlight
+    {
+        Command command;
+        Offer offer;
+    };
+
+    void pump();
+    void resume(const std::function<void()>& step);
+        /// Runs step, reconnecting and running it again after a
+        /// lost connection as far as the session allows.
+    void sendCheck(Offer offer);
+    void sendTakeThis(Offer offer);
+    static bool isEncoded(const std::string& article);
+        /// Returns true if the article can be sent verbatim.
+    void receiveResponse();
+    void promoteDeferred();
+    void finish(const std::string& messageId, Result result);
+
+    std::size_t m_window;
+    Poco::Timespan m_retryDelay;
+    int m_maxAttempts;
+    ResultCallback m_callback;
+    std::deque<Offer> m_ready;
+    std::deque<InFlight> m_inFlight;
+    std::deque<Offer> m_deferred;
+    Statistics m_statistics;
+    std::size_t m_answered{};
+    bool m_streaming{};
+};
+
+
+//
+// inlines
+//
+inline std::size_t NNTPStreamFeeder::window() const
+{
+    return m_window;
+}
+
+
+inline Poco::Timespan NNTPStreamFeeder::retryDelay() const
+{
+    return m_retryDelay;
+}
+
+
+inline int NNTPStreamFeeder::maxAttempts() const
+{
+    return m_maxAttempts;
+}
+
+
+inline std::size_t NNTPStreamFeeder::pending() const
+{
+    return m_ready.size() + m_inFlight.size() + m_deferred.size();
+}
+
+
+inline const NNTPStreamFeeder::Statistics& NNTPStreamFeeder::statistics() const
+{
+    return m_statistics;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_NNTPStreamFeeder_INCLUDED
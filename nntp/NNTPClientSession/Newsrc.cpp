@@ -0,0 +1,297 @@
+//
+// Newsrc.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  Newsrc
+//
+
+
+#include "Newsrc.h"
+
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+#include "Poco/Path.h"
+#include "Poco/TemporaryFile.h"
+
+#include <charconv>
+#include <iterator>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+std::string readFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in)
+        return std::string();
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+template <typename Function>
+void forEachLine(std::string_view text, Function function)
+{
+    while (!text.empty())
+    {
+        std::size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        function(line);
+        if (end == std::string_view::npos)
+            break;
+        text.remove_prefix(end + 1);
+    }
+}
+
+} // namespace
+
+
+Newsrc::Newsrc(const std::string& path):
+    m_path(path),
+    m_journalPath(path + ".journal")
+{
+    load();
+    replay();
+}
+
+
+Newsrc::~Newsrc()
+{
+}
+
+
+bool Newsrc::subscribed(const std::string& group) const
+{
+    const Group* entry = find(group);
+    return entry && entry->subscribed;
+}
+
+
+void Newsrc::subscribe(const std::string& name, bool subscribe)
+{
+    Group& entry = group(name);
+    if (entry.subscribed == subscribe)
+        return;
+    entry.subscribed = subscribe;
+    journal(subscribe ? 's' : 'u', name);
+}
+
+
+void Newsrc::markRead(const std::string& group, uint_t number)
+{
+    markRead(group, number, number);
+}
+
+
+void Newsrc::markRead(const std::string& name, uint_t first, uint_t last)
+{
+    Group& entry = group(name);
+    if (first > last || entry.read.count(first, last) == std::size_t(last - first) + 1)
+        return;
+    entry.read.add(first, last);
+    journal('+', name, first, last);
+}
+
+
+void Newsrc::markUnread(const std::string& name, uint_t number)
+{
+    Group& entry = group(name);
+    if (!entry.read.contains(number))
+        return;
+    entry.read.remove(number);
+    journal('-', name, number, number);
+}
+
+
+bool Newsrc::isRead(const std::string& group, uint_t number) const
+{
+    const Group* entry = find(group);
+    return entry && entry->read.contains(number);
+}
+
+
+std::size_t Newsrc::unreadCount(const std::string& group, uint_t low, uint_t high) const
+{
+    if (low > high || low == 0)
+        return 0;
+    const std::size_t total = std::size_t(high - low) + 1;
+    const Group* entry = find(group);
+    return entry ? total - entry->read.count(low, high) : total;
+}
+
+
+const ArticleSet& Newsrc::read(const std::string& group) const
+{
+    static const ArticleSet none;
+    const Group* entry = find(group);
+    return entry ? entry->read : none;
+}
+
+
+std::vector<std::string> Newsrc::groups() const
+{
+    std::vector<std::string> names;
+    names.reserve(m_groups.size());
+    for (const Group& entry : m_groups)
+        names.push_back(entry.name);
+    return names;
+}
+
+
+void Newsrc::save()
+{
+    Poco::Path path(m_path);
+    Poco::File(path.parent()).createDirectories();
+
+    std::string text;
+    for (const Group& entry : m_groups)
+    {
+        text += entry.name;
+        text += entry.subscribed ? ':' : '!';
+        if (!entry.read.empty())
+        {
+            text += ' ';
+            entry.read.appendTo(text);
+        }
+        text += '\n';
+    }
+
+    const std::string tempPath = Poco::TemporaryFile::tempName(path.parent().toString());
+    {
+        Poco::FileOutputStream out(tempPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!out)
+            throw Poco::WriteFileException(tempPath);
+    }
+    Poco::File(tempPath).renameTo(m_path);
+
+    // replaying the journal over the new file would be harmless, since
+    // every entry is idempotent, so a crash before this point loses nothing
+    if (m_journal.is_open())
+        m_journal.close();
+    Poco::File journal(m_journalPath);
+    if (journal.exists())
+        journal.remove();
+}
+
+
+void Newsrc::load()
+{
+    const std::string text = readFile(m_path);
+    forEachLine(text, [this](std::string_view line)
+    {
+        const std::size_t mark = line.find_first_of(":!");
+        if (mark == std::string_view::npos || mark == 0)
+            return;
+        Group& entry = group(std::string(line.substr(0, mark)));
+        entry.subscribed = line[mark] == ':';
+        entry.read.parse(line.substr(mark + 1));
+    });
+}
+
+
+void Newsrc::replay()
+{
+    // only lines that were completely written are applied; a partial
+    // last line, e.g. after a crash, is cut off so that the next change
+    // journaled does not get appended to it
+    const std::string text = readFile(m_journalPath);
+    const std::size_t complete = text.rfind('\n') + 1;
+    forEachLine(std::string_view(text).substr(0, complete), [this](std::string_view line) { apply(line); });
+    if (complete < text.size())
+        Poco::File(m_journalPath).setSize(complete);
+}
+
+
+bool Newsrc::apply(std::string_view line)
+{
+    if (line.size() < 3 || line[1] != ' ')
+        return false;
+
+    const char change = line[0];
+    line.remove_prefix(2);
+    const std::size_t space = line.find(' ');
+    const std::string name(line.substr(0, space));
+    const std::string_view ranges = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+    switch (change)
+    {
+    case 's':
+    case 'u':
+        group(name).subscribed = change == 's';
+        return true;
+    case '+':
+        return group(name).read.parse(ranges);
+    case '-':
+    {
+        ArticleSet unread;
+        if (!unread.parse(ranges))
+            return false;
+        group(name).read -= unread;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+
+Newsrc::Group& Newsrc::group(const std::string& name)
+{
+    auto it = m_index.find(name);
+    if (it != m_index.end())
+        return m_groups[it->second];
+
+    m_index.emplace(name, m_groups.size());
+    m_groups.emplace_back();
+    m_groups.back().name = name;
+    return m_groups.back();
+}
+
+
+const Newsrc::Group* Newsrc::find(const std::string& name) const
+{
+    auto it = m_index.find(name);
+    return it != m_index.end() ? &m_groups[it->second] : nullptr;
+}
+
+
+void Newsrc::journal(char change, const std::string& group, uint_t first, uint_t last)
+{
+    if (!m_journal.is_open())
+    {
+        Poco::File(Poco::Path(m_journalPath).parent()).createDirectories();
+        m_journal.open(m_journalPath, std::ios::out | std::ios::app | std::ios::binary);
+        if (!m_journal)
+            throw Poco::CreateFileException(m_journalPath);
+    }
+
+    std::string line(1, change);
+    line += ' ';
+    line += group;
+    if (change == '+' || change == '-')
+    {
+        char buffer[24];
+        line += ' ';
+        line.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), first).ptr);
+        if (last != first)
+        {
+            line += '-';
+            line.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), last).ptr);
+        }
+    }
+    line += '\n';
+    m_journal.write(line.data(), static_cast<std::streamsize>(line.size()));
+    m_journal.flush();
+    if (!m_journal)
+        throw Poco::WriteFileException(m_journalPath);
+}
+
+
+} } // namespace Poco::Net
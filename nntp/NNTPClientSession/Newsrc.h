@@ -0,0 +1,120 @@
+//
+// Newsrc.h
+//
+// Library: Net
+// Package: Mail
+// Module:  Newsrc
+//
+// Definition of the Newsrc class.
+//
+
+
+#ifndef Net_Newsrc_INCLUDED
+#define Net_Newsrc_INCLUDED
+
+
+#include "ArticleSet.h"
+#include "NNTPClientSession.h"
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API Newsrc
+    /// The subscriptions and read articles of a user, kept in the
+    /// traditional .newsrc format of "group: ranges" lines, where
+    /// "group!" marks a group that is not subscribed.
+    ///
+    /// Changes are not written to the file itself but appended to
+    /// a journal next to it (path.journal) as lines such as
+    /// "+ group 1-20", "- group 7", "s group" and "u group", so
+    /// marking an article read costs a single short append however
+    /// large the file is. The journal is replayed when the file is
+    /// loaded and folded into it by save(), which replaces the file
+    /// atomically.
+    ///
+    /// Groups keep the order in which they appear in the file.
+{
+public:
+    explicit Newsrc(const std::string& path);
+        /// Loads the .newsrc at the given path, if it exists, and
+        /// replays its journal.
+
+    ~Newsrc();
+
+    bool subscribed(const std::string& group) const;
+
+    void subscribe(const std::string& group, bool subscribe = true);
+        /// Subscribes to or unsubscribes from the group, adding it
+        /// if necessary.
+
+    void markRead(const std::string& group, uint_t number);
+    void markRead(const std::string& group, uint_t first, uint_t last);
+        /// Marks the articles from first to last as read.
+
+    void markUnread(const std::string& group, uint_t number);
+
+    bool isRead(const std::string& group, uint_t number) const;
+
+    std::size_t unreadCount(const std::string& group, uint_t low, uint_t high) const;
+        /// Returns the number of articles from low to high (as reported
+        /// by GROUP) that have not been read. Since the range may have
+        /// gaps, this is an upper bound; subtract the read articles
+        /// from a LISTGROUP result for the exact set.
+
+    const ArticleSet& read(const std::string& group) const;
+        /// Returns the read articles of the group.
+
+    std::vector<std::string> groups() const;
+        /// Returns the names of all groups in file order.
+
+    void save();
+        /// Writes the complete file and empties the journal.
+
+    const std::string& path() const;
+
+private:
+    struct Group
+    {
+        std::string name;
+        bool subscribed{true};
+        ArticleSet read;
+    };
+
+    Newsrc(const Newsrc&) = delete;
+    Newsrc& operator=(const Newsrc&) = delete;
+
+    void load();
+    void replay();
+    bool apply(std::string_view line);
+    Group& group(const std::string& name);
+    const Group* find(const std::string& name) const;
+    void journal(char change, const std::string& group, uint_t first = 0, uint_t last = 0);
+
+    std::string m_path;
+    std::string m_journalPath;
+    std::vector<Group> m_groups;
+    std::unordered_map<std::string, std::size_t> m_index;
+    std::ofstream m_journal;
+};
+
+
+//
+// inlines
+//
+inline const std::string& Newsrc::path() const
+{
+    return m_path;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_Newsrc_INCLUDED
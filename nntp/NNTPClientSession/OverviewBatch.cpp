@@ -0,0 +1,290 @@
+//
+// OverviewBatch.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  OverviewBatch
+//
+
+
+#include "OverviewBatch.h"
+#include "MessageDate.h"
+
+#include <algorithm>
+#include <charconv>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NNTP_OVERVIEW_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const std::vector<std::string> STANDARD_FORMAT = {"Subject:", "From:", "Date:", "Message-ID:", "References:", ":bytes", ":lines"};
+
+inline unsigned lowestBit(unsigned mask)
+    // mask must not be zero
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+template <typename Function>
+void forEachDelimiter(const char* data, std::size_t size, Function function)
+    // calls function with the offset of every TAB and LF, in order;
+    // a CR before an LF is left to the caller
+{
+    std::size_t i = 0;
+#if defined(NNTP_OVERVIEW_SSE2)
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(block, tab), _mm_cmpeq_epi8(block, lf))));
+        for (; mask; mask &= mask - 1)
+            function(i + lowestBit(mask));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        if (data[i] == '\t' || data[i] == '\n')
+            function(i);
+    }
+}
+
+bool equalsIgnoreCase(std::string_view text, std::string_view lower)
+{
+    if (text.size() != lower.size())
+        return false;
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        const char c = text[i] >= 'A' && text[i] <= 'Z' ? static_cast<char>(text[i] + ('a' - 'A')) : text[i];
+        if (c != lower[i])
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+OverviewBatch::OverviewBatch(unsigned fields):
+    m_fields(fields)
+{
+    setFormat(STANDARD_FORMAT);
+}
+
+
+OverviewBatch::~OverviewBatch()
+{
+}
+
+
+void OverviewBatch::setFormat(const std::vector<std::string>& format)
+{
+    static const char* const NAMES[FIELDS] = {"subject", "from", "date", "message-id", "references", "xref", "bytes", "lines"};
+
+    std::fill(m_positions, m_positions + FIELDS, -1);
+    std::fill(m_full, m_full + FIELDS, false);
+    for (std::size_t i = 0; i < format.size() && i + 1 < MAX_LINE_FIELDS; ++i)
+    {
+        // "Subject:", ":bytes", "Xref:full"
+        std::string_view name(format[i]);
+        while (!name.empty() && (name.back() == ' ' || name.back() == '\r'))
+            name.remove_suffix(1);
+        const bool full = name.size() > 5 && equalsIgnoreCase(name.substr(name.size() - 5), ":full");
+        if (full)
+            name.remove_suffix(4);
+        if (!name.empty() && name.front() == ':')
+            name.remove_prefix(1);
+        else if (!name.empty() && name.back() == ':')
+            name.remove_suffix(1);
+        for (int field = 0; field < FIELDS; ++field)
+        {
+            if (m_positions[field] < 0 && equalsIgnoreCase(name, NAMES[field]))
+            {
+                m_positions[field] = static_cast<int>(i + 1);
+                m_full[field] = full;
+            }
+        }
+    }
+}
+
+
+bool OverviewBatch::add(std::string_view line)
+{
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+        line.remove_suffix(1);
+
+    std::string_view fields[MAX_LINE_FIELDS];
+    std::size_t count = 0;
+    std::size_t begin = 0;
+    forEachDelimiter(line.data(), line.size(), [&](std::size_t pos)
+    {
+        if (count + 1 < MAX_LINE_FIELDS)
+        {
+            fields[count++] = line.substr(begin, pos - begin);
+            begin = pos + 1;
+        }
+    });
+    fields[count++] = line.substr(begin);
+    return addFields(fields, count);
+}
+
+
+std::size_t OverviewBatch::addLines(std::string_view text)
+{
+    const char* const data = text.data();
+    std::string_view fields[MAX_LINE_FIELDS];
+    std::size_t count = 0;
+    std::size_t begin = 0;
+    std::size_t consumed = 0;
+    forEachDelimiter(data, text.size(), [&](std::size_t pos)
+    {
+        if (data[pos] == '\t')
+        {
+            if (count + 1 < MAX_LINE_FIELDS)
+            {
+                fields[count++] = std::string_view(data + begin, pos - begin);
+                begin = pos + 1;
+            }
+            return;
+        }
+
+        std::size_t end = pos;
+        if (end > begin && data[end - 1] == '\r')
+            --end;
+        fields[count++] = std::string_view(data + begin, end - begin);
+        addFields(fields, count);
+        count = 0;
+        begin = consumed = pos + 1;
+    });
+    return consumed;
+}
+
+
+bool OverviewBatch::addFields(const std::string_view* fields, std::size_t count)
+{
+    // the article number and the seven mandatory fields
+    if (count < 8)
+        return false;
+
+    uint_t number;
+    if (std::from_chars(fields[0].data(), fields[0].data() + fields[0].size(), number).ec != std::errc())
+        return false;
+
+    std::size_t values[2] = {0, 0};
+    for (int field = BYTES; field <= LINES; ++field)
+    {
+        const int position = m_positions[field];
+        if ((m_fields & (1u << field)) && position >= 0 && static_cast<std::size_t>(position) < count)
+        {
+            const std::string_view value = fields[position];
+            std::from_chars(value.data(), value.data() + value.size(), values[field - BYTES]);
+        }
+    }
+    m_numbers.push_back(number);
+    m_bytes.push_back(values[0]);
+    m_lines.push_back(values[1]);
+
+    for (int field = 0; field < TEXT_FIELDS; ++field)
+    {
+        Column& column = m_columns[field];
+        const int position = m_positions[field];
+        if ((m_fields & (1u << field)) && position >= 0 && static_cast<std::size_t>(position) < count)
+        {
+            std::string_view value = fields[position];
+            if (m_full[field])
+            {
+                // "Xref: host group:number" carries its header name
+                const std::size_t colon = value.find(':');
+                if (colon != std::string_view::npos)
+                    value.remove_prefix(colon + 1);
+                while (!value.empty() && value.front() == ' ')
+                    value.remove_prefix(1);
+            }
+            column.data.append(value.data(), value.size());
+        }
+        column.ends.push_back(column.data.size());
+    }
+    return true;
+}
+
+
+void OverviewBatch::add(const OverviewRecord& record)
+{
+    const std::string* fields[XREF] = {&record.subject, &record.from, &record.date, &record.messageId, &record.references};
+    m_numbers.push_back(record.number);
+    m_bytes.push_back(m_fields & (1u << BYTES) ? record.bytes : 0);
+    m_lines.push_back(m_fields & (1u << LINES) ? record.lines : 0);
+    for (int field = 0; field < TEXT_FIELDS; ++field)
+    {
+        Column& column = m_columns[field];
+        if (field < XREF && (m_fields & (1u << field)))
+            column.data += *fields[field];
+        column.ends.push_back(column.data.size());
+    }
+}
+
+
+void OverviewBatch::reserve(std::size_t records)
+{
+    m_numbers.reserve(records);
+    m_bytes.reserve(records);
+    m_lines.reserve(records);
+    for (Column& column : m_columns)
+        column.ends.reserve(records);
+}
+
+
+void OverviewBatch::clear()
+{
+    m_numbers.clear();
+    m_bytes.clear();
+    m_lines.clear();
+    for (Column& column : m_columns)
+    {
+        column.data.clear();
+        column.ends.clear();
+    }
+}
+
+
+void OverviewBatch::record(std::size_t index, OverviewRecord& record) const
+{
+    record.number = m_numbers[index];
+    record.subject = subject(index);
+    record.from = from(index);
+    record.date = date(index);
+    record.messageId = messageId(index);
+    record.references = references(index);
+    record.bytes = m_bytes[index];
+    record.lines = m_lines[index];
+}
+
+
+void OverviewBatch::timestamps(std::vector<Poco::Timestamp::TimeVal>& times) const
+{
+    times.resize(size());
+    for (std::size_t i = 0; i < size(); ++i)
+        times[i] = MessageDate::parse(date(i));
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,229 @@
+//
+// OverviewBatch.h
+//
+// Library: Net
+// Package: Mail
+// Module:  OverviewBatch
+//
+// Definition of the OverviewBatch class.
+//
+
+
+#ifndef Net_OverviewBatch_INCLUDED
+#define Net_OverviewBatch_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include "Poco/Timestamp.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API OverviewBatch
+    /// The overview records of many articles, stored column by
+    /// column rather than as one object per article.
+    ///
+    /// Each text field lives in a single string per column, with
+    /// the records' end offsets beside it, so a batch of a large
+    /// group costs a handful of allocations, and code that looks at
+    /// one field of every record (filtering, sorting, scoring) walks
+    /// contiguous memory.
+    ///
+    /// Lines are parsed according to the server's field order from
+    /// LIST OVERVIEW.FMT (see setFormat()), which may add fields such
+    /// as Xref after the standard ones. Only the requested fields are
+    /// stored; the others are left empty. Blocks of lines are split
+    /// with a single SSE2 scan for TAB and LF where available.
+{
+public:
+    enum Field
+    {
+        SUBJECT,
+        FROM,
+        DATE,
+        MESSAGE_ID,
+        REFERENCES,
+        XREF,
+        TEXT_FIELDS,
+        BYTES = TEXT_FIELDS,
+        LINES,
+        FIELDS
+    };
+
+    enum
+    {
+        ALL_FIELDS = (1 << FIELDS) - 1,
+        MAX_LINE_FIELDS = 32 // fields beyond this are ignored
+    };
+
+    explicit OverviewBatch(unsigned fields = ALL_FIELDS);
+        /// Creates a batch storing the fields whose bits, 1 << Field,
+        /// are set in fields.
+
+    ~OverviewBatch();
+
+    void setFormat(const std::vector<std::string>& format);
+        /// Sets the field order from the lines of LIST OVERVIEW.FMT,
+        /// e.g. "Subject:", ":bytes" or "Xref:full". Fields marked
+        /// "full" carry their header name, which is removed. The
+        /// default is the standard order of RFC 3977.
+
+    bool add(std::string_view line);
+        /// Parses an overview line and appends it. Returns false,
+        /// leaving the batch unchanged, if the line lacks any of the
+        /// mandatory fields.
+
+    std::size_t addLines(std::string_view text);
+        /// Parses and appends the complete LF or CRLF terminated lines
+        /// at the start of text, skipping malformed ones, and returns
+        /// the number of bytes consumed. An unterminated last line is
+        /// left for the caller to complete.
+
+    void add(const OverviewRecord& record);
+
+    void reserve(std::size_t records);
+
+    void clear();
+
+    std::size_t size() const;
+
+    bool empty() const;
+
+    uint_t number(std::size_t index) const;
+
+    std::string_view text(Field field, std::size_t index) const;
+
+    std::string_view subject(std::size_t index) const;
+    std::string_view from(std::size_t index) const;
+    std::string_view date(std::size_t index) const;
+    std::string_view messageId(std::size_t index) const;
+    std::string_view references(std::size_t index) const;
+    std::string_view xref(std::size_t index) const;
+
+    std::size_t bytes(std::size_t index) const;
+    std::size_t lines(std::size_t index) const;
+
+    const std::vector<uint_t>& numbers() const;
+
+    void record(std::size_t index, OverviewRecord& record) const;
+        /// Copies the given row into record.
+
+    void timestamps(std::vector<Poco::Timestamp::TimeVal>& times) const;
+        /// Parses the Date column with MessageDate, storing the time
+        /// of each row in microseconds since the epoch, or 0 if its
+        /// date cannot be parsed. Sorting rows by these gives a date
+        /// index of the batch.
+
+private:
+    struct Column
+    {
+        std::string data;
+        std::vector<std::size_t> ends;
+    };
+
+    bool addFields(const std::string_view* fields, std::size_t count);
+
+    unsigned m_fields;
+    int m_positions[FIELDS];  // index of each field in a line, or -1
+    bool m_full[FIELDS];
+
+    std::vector<uint_t> m_numbers;
+    std::vector<std::size_t> m_bytes;
+    std::vector<std::size_t> m_lines;
+    Column m_columns[TEXT_FIELDS];
+};
+
+
+//
+// inlines
+//
+inline std::size_t OverviewBatch::size() const
+{
+    return m_numbers.size();
+}
+
+
+inline bool OverviewBatch::empty() const
+{
+    return m_numbers.empty();
+}
+
+
+inline uint_t OverviewBatch::number(std::size_t index) const
+{
+    return m_numbers[index];
+}
+
+
+inline std::string_view OverviewBatch::text(Field field, std::size_t index) const
+{
+    const Column& column = m_columns[field];
+    const std::size_t begin = index == 0 ? 0 : column.ends[index - 1];
+    return std::string_view(column.data.data() + begin, column.ends[index] - begin);
+}
+
+
+inline std::string_view OverviewBatch::subject(std::size_t index) const
+{
+    return text(SUBJECT, index);
+}
+
+
+inline std::string_view OverviewBatch::from(std::size_t index) const
+{
+    return text(FROM, index);
+}
+
+
+inline std::string_view OverviewBatch::date(std::size_t index) const
+{
+    return text(DATE, index);
+}
+
+
+inline std::string_view OverviewBatch::messageId(std::size_t index) const
+{
+    return text(MESSAGE_ID, index);
+}
+
+
+inline std::string_view OverviewBatch::references(std::size_t index) const
+{
+    return text(REFERENCES, index);
+}
+
+
+inline std::string_view OverviewBatch::xref(std::size_t index) const
+{
+    return text(XREF, index);
+}
+
+
+inline std::size_t OverviewBatch::bytes(std::size_t index) const
+{
+    return m_bytes[index];
+}
+
+
+inline std::size_t OverviewBatch::lines(std::size_t index) const
+{
+    return m_lines[index];
+}
+
+
+inline const std::vector<uint_t>& OverviewBatch::numbers() const
+{
+    return m_numbers;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_OverviewBatch_INCLUDED
@@ -0,0 +1,245 @@
+//
+// ResponseReader.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  ResponseReader
+//
+
+
+#include "ResponseReader.h"
+#include "NNTPClientSession.h"
+#include "StatusLine.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#define NNTP_RESPONSE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NNTP_RESPONSE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+inline unsigned lowestBit(unsigned mask)
+    // mask must not be zero
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+} // namespace
+
+
+ResponseReader::ResponseReader(DialogSocket& socket, std::size_t bufferSize):
+    m_socket(socket)
+{
+    m_buffer.resize(bufferSize);
+}
+
+
+ResponseReader::~ResponseReader()
+{
+}
+
+
+int ResponseReader::readStatus(std::string& response)
+{
+    for (;;)
+    {
+        const char* const begin = m_buffer.data() + m_begin;
+        const char* const end = m_buffer.data() + m_end;
+        const char* const lf = findLineFeed(begin, end);
+        if (lf != end)
+        {
+            std::size_t length = static_cast<std::size_t>(lf - begin);
+            if (length > 0 && lf[-1] == '\r')
+                --length;
+            response.assign(begin, length);
+            m_begin += static_cast<std::size_t>(lf + 1 - begin);
+            break;
+        }
+        if (m_end - m_begin == m_buffer.size())
+            throw NNTPException("Status line too long");
+        fill(m_end - m_begin + 1);
+    }
+
+    return StatusLine::parseStatus(response);
+}
+
+
+std::streamsize ResponseReader::readBlocks(const BlockHandler& handler)
+{
+    std::streamsize written = 0;
+    bool lineStart = true;
+    for (;;)
+    {
+        if (m_begin == m_end)
+            fill(1);
+
+        if (lineStart)
+        {
+            lineStart = false;
+            if (m_buffer[m_begin] == '.')
+            {
+                // a dot is stuffing unless the line is just ".\r\n"
+                fill(2);
+                if (m_buffer[m_begin + 1] == '\r')
+                {
+                    fill(3);
+                    if (m_buffer[m_begin + 2] == '\n')
+                    {
+                        m_begin += 3;
+                        return written;
+                    }
+                }
+                ++m_begin;
+                continue;
+            }
+        }
+
+        const char* const begin = m_buffer.data() + m_begin;
+        const char* const end = m_buffer.data() + m_end;
+        const char* const dotLine = findDotLine(begin, end);
+        const char* stop;
+        if (dotLine != end)
+        {
+            stop = dotLine + 1;
+            lineStart = true;
+        }
+        else
+        {
+            // a dot may still follow an LF at the very end
+            stop = end;
+            lineStart = end[-1] == '\n';
+        }
+        const std::size_t size = static_cast<std::size_t>(stop - begin);
+        handler(begin, size);
+        written += static_cast<std::streamsize>(size);
+        m_begin += size;
+    }
+}
+
+
+void ResponseReader::readLines(const LineHandler& handler)
+{
+    m_line.clear();
+    readBlocks([this, &handler](const char* data, std::size_t size)
+        {
+            const char* const end = data + size;
+            while (data != end)
+            {
+                const char* const lf = findLineFeed(data, end);
+                if (lf == end)
+                {
+                    m_line.append(data, end);
+                    return;
+                }
+
+                std::string_view line(data, static_cast<std::size_t>(lf - data));
+                if (!m_line.empty())
+                {
+                    m_line.append(data, lf);
+                    line = m_line;
+                }
+                if (!line.empty() && line.back() == '\r')
+                    line.remove_suffix(1);
+                handler(line);
+                m_line.clear();
+                data = lf + 1;
+            }
+        });
+}
+
+
+const char* ResponseReader::findDotLine(const char* begin, const char* end)
+{
+    const char* p = begin;
+#if defined(NNTP_RESPONSE_AVX2)
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i dot = _mm256_set1_epi8('.');
+    for (; end - p > 32; p += 32)
+    {
+        // compare each byte with LF and the byte after it with '.'
+        const __m256i here = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(here, lf), _mm256_cmpeq_epi8(next, dot))));
+        if (mask)
+            return p + lowestBit(mask);
+    }
+#elif defined(NNTP_RESPONSE_SSE2)
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i dot = _mm_set1_epi8('.');
+    for (; end - p > 16; p += 16)
+    {
+        // compare each byte with LF and the byte after it with '.'
+        const __m128i here = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(here, lf), _mm_cmpeq_epi8(next, dot))));
+        if (mask)
+            return p + lowestBit(mask);
+    }
+#endif
+    for (; end - p > 1; ++p)
+    {
+        if (p[0] == '\n' && p[1] == '.')
+            return p;
+    }
+    return end;
+}
+
+
+const char* ResponseReader::findLineFeed(const char* begin, const char* end)
+{
+    const void* lf = begin == end ? nullptr : std::memchr(begin, '\n', static_cast<std::size_t>(end - begin));
+    return lf ? static_cast<const char*>(lf) : end;
+}
+
+
+void ResponseReader::setWaitHandler(const WaitHandler& handler)
+{
+    m_waitHandler = handler;
+}
+
+
+void ResponseReader::fill(std::size_t count)
+{
+    if (m_begin == m_end)
+        m_begin = m_end = 0;
+    while (m_end - m_begin < count)
+    {
+        if (m_end == m_buffer.size() || m_buffer.size() - m_begin < count)
+        {
+            std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+        }
+        if (m_waitHandler)
+            m_waitHandler();
+        int n = m_socket.receiveRawBytes(m_buffer.data() + m_end, static_cast<int>(m_buffer.size() - m_end));
+        if (n <= 0)
+            throw ConnectionResetException("Connection closed in the middle of a response");
+        m_end += static_cast<std::size_t>(n);
+    }
+}
+
+
+} } // namespace Poco::Net
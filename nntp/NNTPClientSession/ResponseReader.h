@@ -0,0 +1,122 @@
+//
+// ResponseReader.h
+//
+// Library: Net
+// Package: Mail
+// Module:  ResponseReader
+//
+// Definition of the ResponseReader class.
+//
+
+
+#ifndef Net_ResponseReader_INCLUDED
+#define Net_ResponseReader_INCLUDED
+
+
+#include "Poco/Net/DialogSocket.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class ResponseReader
+    /// Reads NNTP responses through a large buffer of its own, for
+    /// use by NNTPClientSession.
+    ///
+    /// Multi-line responses are framed a buffer at a time: the only
+    /// places that need attention are lines starting with a dot,
+    /// which are either dot-stuffed or the terminator, and these are
+    /// located by a vectorized search for LF followed by '.' (AVX2 or
+    /// SSE2 where the compiler targets them, scalar otherwise). The
+    /// text between them is passed on where it lies, without copying.
+    /// Line consumers get the lines cut out of those blocks with
+    /// memchr(), which C libraries vectorize themselves.
+    ///
+    /// Bytes that follow a response, e.g. the next responses of a
+    /// pipeline, stay buffered for the following read. Reads go
+    /// through DialogSocket::receiveRawBytes(), which hands out the
+    /// socket's own buffered bytes first, so the reader may take over
+    /// from DialogSocket after any status line; as long as pending()
+    /// is true, however, all reads must go through the reader.
+{
+public:
+    using BlockHandler = std::function<void(const char* data, std::size_t size)>;
+    using LineHandler = std::function<void(std::string_view line)>;
+    using WaitHandler = std::function<void()>;
+
+    ResponseReader(DialogSocket& socket, std::size_t bufferSize);
+    ~ResponseReader();
+
+    bool pending() const;
+        /// Returns true if bytes beyond the last response read
+        /// are buffered.
+
+    int readStatus(std::string& response);
+        /// Reads a status line, without its CRLF, into response and
+        /// returns the status code, or 0 if the line has none.
+
+    std::streamsize readBlocks(const BlockHandler& handler);
+        /// Passes the unstuffed text of a multi-line response, with
+        /// CRLF line endings but without the terminator, to the
+        /// handler in pieces as large as the buffer allows. Returns
+        /// the number of bytes passed.
+
+    void readLines(const LineHandler& handler);
+        /// Passes each unstuffed line of a multi-line response,
+        /// without its line ending, to the handler.
+
+    void clear();
+        /// Discards any buffered bytes, e.g. when the connection
+        /// is dropped.
+
+    void setWaitHandler(const WaitHandler& handler);
+        /// Sets a function called whenever the reader is about to
+        /// receive from the socket, e.g. to wait for data with a
+        /// deadline. It may throw to abandon the read.
+
+    static const char* findDotLine(const char* begin, const char* end);
+        /// Returns the first LF in begin..end that is followed by a
+        /// dot, or end if there is none.
+
+    static const char* findLineFeed(const char* begin, const char* end);
+        /// Returns the first LF in begin..end, or end.
+
+private:
+    ResponseReader(const ResponseReader&) = delete;
+    ResponseReader& operator=(const ResponseReader&) = delete;
+
+    void fill(std::size_t count);
+
+    DialogSocket& m_socket;
+    std::vector<char> m_buffer;
+    std::size_t m_begin{};
+    std::size_t m_end{};
+    std::string m_line;
+    WaitHandler m_waitHandler;
+};
+
+
+//
+// inlines
+//
+inline bool ResponseReader::pending() const
+{
+    return m_begin != m_end;
+}
+
+
+inline void ResponseReader::clear()
+{
+    m_begin = m_end = 0;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_ResponseReader_INCLUDED
@@ -0,0 +1,61 @@
+//
+// StatusLine.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  StatusLine
+//
+
+
+#include "StatusLine.h"
+
+#include <charconv>
+
+
+namespace Poco {
+namespace Net {
+
+
+StatusLine::StatusLine(std::string_view line):
+    m_count(0)
+{
+    std::size_t begin = line.find_first_not_of(' ');
+    while (begin != std::string_view::npos && m_count < MAX_FIELDS)
+    {
+        std::size_t end = m_count + 1 < MAX_FIELDS ? line.find(' ', begin) : std::string_view::npos;
+        m_fields[m_count++] = line.substr(begin, end == std::string_view::npos ? end : end - begin);
+        begin = end == std::string_view::npos ? end : line.find_first_not_of(' ', end);
+    }
+}
+
+
+bool StatusLine::number(std::size_t index, uint_t& value) const
+{
+    if (index >= m_count)
+        return false;
+    const std::string_view field = m_fields[index];
+    uint_t parsed;
+    const std::from_chars_result result = std::from_chars(field.data(), field.data() + field.size(), parsed);
+    if (result.ec != std::errc() || result.ptr != field.data() + field.size())
+        return false;
+    value = parsed;
+    return true;
+}
+
+
+int StatusLine::parseStatus(std::string_view line)
+{
+    if (line.size() < 3)
+        return 0;
+    int status = 0;
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        if (line[i] < '0' || line[i] > '9')
+            return 0;
+        status = status*10 + (line[i] - '0');
+    }
+    return status;
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,89 @@
+//
+// StatusLine.h
+//
+// Library: Net
+// Package: Mail
+// Module:  StatusLine
+//
+// Definition of the StatusLine class.
+//
+
+
+#ifndef Net_StatusLine_INCLUDED
+#define Net_StatusLine_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include <cstddef>
+#include <string_view>
+
+namespace Poco {
+namespace Net {
+
+class NNTP_API StatusLine
+    /// The space separated fields of an NNTP status line, such as
+    /// "211 90986 1 91036 misc.test" or "223 3000234 <45223423@example.com>",
+    /// split in place.
+    ///
+    /// The fields refer to the line, which must outlive the object;
+    /// numbers are read with std::from_chars. Nothing is allocated,
+    /// so responses can be taken apart in tight command loops.
+{
+public:
+    enum
+    {
+        MAX_FIELDS = 8 // further text is left in the last field
+    };
+
+    explicit StatusLine(std::string_view line);
+
+    int status() const;
+        /// Returns the three digit status code, or 0 if the line
+        /// does not start with one.
+
+    std::size_t count() const;
+        /// Returns the number of fields, the status code included.
+
+    std::string_view operator[](std::size_t index) const;
+        /// Returns the given field, or an empty one if the line has
+        /// fewer fields.
+
+    bool number(std::size_t index, uint_t& value) const;
+        /// Parses the given field as a decimal number. Returns false,
+        /// leaving value unchanged, if it is missing or not a number.
+
+    static int parseStatus(std::string_view line);
+        /// Returns the status code at the start of line, or 0.
+
+private:
+    std::string_view m_fields[MAX_FIELDS];
+    std::size_t m_count;
+};
+
+
+//
+// inlines
+//
+inline int StatusLine::status() const
+{
+    return m_count > 0 ? parseStatus(m_fields[0]) : 0;
+}
+
+
+inline std::size_t StatusLine::count() const
+{
+    return m_count;
+}
+
+
+inline std::string_view StatusLine::operator[](std::size_t index) const
+{
+    return index < m_count ? m_fields[index] : std::string_view();
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_StatusLine_INCLUDED
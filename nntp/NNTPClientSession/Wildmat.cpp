@@ -0,0 +1,222 @@
+//
+// Wildmat.cpp
+//
+// Library: Net
+// Package: Mail
+// Module:  Wildmat
+//
+
+
+#include "Wildmat.h"
+#include "GroupTable.h"
+
+#include <algorithm>
+
+
+namespace Poco {
+namespace Net {
+
+
+namespace
+{
+
+const std::size_t NO_MATCH = std::string_view::npos;
+
+std::size_t codePointLength(std::string_view text, std::size_t pos)
+{
+    const unsigned char lead = static_cast<unsigned char>(text[pos]);
+    std::size_t length = 1;
+    if (lead >= 0xF0 && lead < 0xF8)
+        length = 4;
+    else if (lead >= 0xE0)
+        length = 3;
+    else if (lead >= 0xC0)
+        length = 2;
+    return std::min(length, text.size() - pos);
+}
+
+bool isLiteral(const std::string& segment)
+{
+    return segment.find('?') == std::string::npos;
+}
+
+std::size_t matchSegment(const std::string& segment, std::string_view text, std::size_t pos)
+{
+    // returns the end of the match starting at pos, or NO_MATCH
+    for (char c : segment)
+    {
+        if (pos >= text.size())
+            return NO_MATCH;
+        if (c == '?')
+            pos += codePointLength(text, pos);
+        else if (text[pos++] != c)
+            return NO_MATCH;
+    }
+    return pos;
+}
+
+std::size_t findSegment(const std::string& segment, std::string_view text, std::size_t& pos)
+{
+    // locates the leftmost match at or after pos; returns its end
+    // and moves pos to its start
+    if (isLiteral(segment))
+    {
+        pos = text.find(segment, pos);
+        return pos == std::string_view::npos ? NO_MATCH : pos + segment.size();
+    }
+    for (; pos <= text.size(); pos += pos < text.size() ? codePointLength(text, pos) : 1)
+    {
+        std::size_t end = matchSegment(segment, text, pos);
+        if (end != NO_MATCH)
+            return end;
+    }
+    return NO_MATCH;
+}
+
+} // namespace
+
+
+Wildmat::Wildmat()
+{
+}
+
+
+Wildmat::Wildmat(std::string_view wildmat)
+{
+    compile(wildmat);
+}
+
+
+Wildmat::~Wildmat()
+{
+}
+
+
+void Wildmat::compile(std::string_view wildmat)
+{
+    m_wildmat = std::string(wildmat);
+    m_patterns.clear();
+    while (!wildmat.empty())
+    {
+        std::size_t comma = wildmat.find(',');
+        std::string_view pattern = wildmat.substr(0, comma);
+        if (!pattern.empty())
+            m_patterns.push_back(compilePattern(pattern));
+        wildmat = comma == std::string_view::npos ? std::string_view() : wildmat.substr(comma + 1);
+    }
+}
+
+
+bool Wildmat::match(std::string_view text) const
+{
+    for (auto it = m_patterns.rbegin(); it != m_patterns.rend(); ++it)
+    {
+        if (matchPattern(*it, text))
+            return !it->negated;
+    }
+    return false;
+}
+
+
+void Wildmat::filter(const GroupTable& groups, std::vector<std::size_t>& matches) const
+{
+    for (std::size_t i = 0; i < groups.size(); ++i)
+    {
+        if (match(groups.name(i)))
+            matches.push_back(i);
+    }
+}
+
+
+Wildmat::Pattern Wildmat::compilePattern(std::string_view text)
+{
+    Pattern pattern;
+    pattern.negated = text[0] == '!';
+    if (pattern.negated)
+        text.remove_prefix(1);
+
+    // "a*b**c" -> "a", "b", "", "c"; drop the empty inner segments
+    // produced by repeated stars, keeping the first and last, which
+    // record whether the pattern is anchored at either end
+    std::vector<std::string> segments;
+    for (std::size_t begin = 0;;)
+    {
+        std::size_t star = text.find('*', begin);
+        std::string_view segment = text.substr(begin, star - begin);
+        bool inner = begin != 0 && star != std::string_view::npos;
+        if (!segment.empty() || !inner)
+            segments.emplace_back(segment);
+        if (star == std::string_view::npos)
+            break;
+        begin = star + 1;
+    }
+
+    const bool literal = std::all_of(segments.begin(), segments.end(), isLiteral);
+    const std::size_t count = segments.size();
+    if (std::all_of(segments.begin(), segments.end(), [](const std::string& segment) { return segment.empty(); }) && count > 1)
+        pattern.kind = MATCH_ANY;
+    else if (literal && count == 1)
+        pattern.kind = MATCH_EXACT;
+    else if (literal && count == 2 && segments[1].empty())
+        pattern.kind = MATCH_PREFIX;
+    else if (literal && count == 2 && segments[0].empty())
+        pattern.kind = MATCH_SUFFIX;
+    else if (literal && count == 3 && segments[0].empty() && segments[2].empty())
+        pattern.kind = MATCH_CONTAINS;
+    else
+        pattern.kind = MATCH_GENERAL;
+    pattern.segments = std::move(segments);
+    return pattern;
+}
+
+
+bool Wildmat::matchPattern(const Pattern& pattern, std::string_view text)
+{
+    const std::vector<std::string>& segments = pattern.segments;
+    switch (pattern.kind)
+    {
+    case MATCH_ANY:
+        return true;
+    case MATCH_EXACT:
+        return text == segments[0];
+    case MATCH_PREFIX:
+        return text.size() >= segments[0].size() && text.compare(0, segments[0].size(), segments[0]) == 0;
+    case MATCH_SUFFIX:
+        return text.size() >= segments[1].size() && text.compare(text.size() - segments[1].size(), segments[1].size(), segments[1]) == 0;
+    case MATCH_CONTAINS:
+        return text.find(segments[1]) != std::string_view::npos;
+    case MATCH_GENERAL:
+        break;
+    }
+
+    // the first segment is anchored at the start
+    std::size_t pos = matchSegment(segments.front(), text, 0);
+    if (pos == NO_MATCH)
+        return false;
+    if (segments.size() == 1)
+        return pos == text.size();
+
+    // inner segments float; taking the leftmost match of each is
+    // optimal because a later start can never end earlier
+    for (std::size_t i = 1; i + 1 < segments.size(); ++i)
+    {
+        std::size_t end = findSegment(segments[i], text, pos);
+        if (end == NO_MATCH)
+            return false;
+        pos = end;
+    }
+
+    // the last segment is anchored at the end
+    const std::string& last = segments.back();
+    if (isLiteral(last))
+        return text.size() - pos >= last.size() && text.compare(text.size() - last.size(), last.size(), last) == 0;
+    for (; pos <= text.size(); pos += pos < text.size() ? codePointLength(text, pos) : 1)
+    {
+        if (matchSegment(last, text, pos) == text.size())
+            return true;
+    }
+    return false;
+}
+
+
+} } // namespace Poco::Net
@@ -0,0 +1,103 @@
+//
+// Wildmat.h
+//
+// Library: Net
+// Package: Mail
+// Module:  Wildmat
+//
+// Definition of the Wildmat class.
+//
+
+
+#ifndef Net_Wildmat_INCLUDED
+#define Net_Wildmat_INCLUDED
+
+
+#include "NNTPClientSession.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Poco {
+namespace Net {
+
+class GroupTable;
+
+class NNTP_API Wildmat
+    /// A compiled RFC 3977 wildmat for matching group names
+    /// and header values on the client side.
+    ///
+    /// A wildmat is a comma-separated list of patterns, each of
+    /// which may be negated with a leading '!'. Within a pattern,
+    /// '*' matches any sequence of characters and '?' matches a
+    /// single UTF-8 character. The rightmost pattern that matches
+    /// decides: the text matches if that pattern is not negated.
+    ///
+    /// Each pattern is compiled once into the cheapest matcher for
+    /// its shape: exact comparison, prefix, suffix or substring test,
+    /// or, for general patterns, a sequence of literal segments that
+    /// are located left to right. Matching never backtracks, so the
+    /// cost is linear in the length of the text.
+{
+public:
+    Wildmat();
+        /// Creates a wildmat that matches nothing.
+
+    explicit Wildmat(std::string_view wildmat);
+        /// Creates a compiled wildmat for the given pattern list.
+
+    ~Wildmat();
+
+    void compile(std::string_view wildmat);
+        /// Replaces the pattern list.
+
+    bool match(std::string_view text) const;
+        /// Returns true if the text matches the wildmat.
+
+    void filter(const GroupTable& groups, std::vector<std::size_t>& matches) const;
+        /// Appends the indexes of all groups whose names match.
+
+    const std::string& wildmat() const;
+
+private:
+    enum Kind
+    {
+        MATCH_ANY,
+        MATCH_EXACT,
+        MATCH_PREFIX,
+        MATCH_SUFFIX,
+        MATCH_CONTAINS,
+        MATCH_GENERAL
+    };
+
+    struct Pattern
+    {
+        Kind kind;
+        bool negated;
+        std::vector<std::string> segments;
+            /// The text between stars, in order; '?' is kept in place.
+    };
+
+    static Pattern compilePattern(std::string_view pattern);
+    static bool matchPattern(const Pattern& pattern, std::string_view text);
+
+    std::string m_wildmat;
+    std::vector<Pattern> m_patterns;
+};
+
+
+//
+// inlines
+//
+inline const std::string& Wildmat::wildmat() const
+{
+    return m_wildmat;
+}
+
+
+} } // namespace Poco::Net
+
+
+#endif // Net_Wildmat_INCLUDED
@@ -1,30 +1,449 @@
+#include "ArticleCache.h"
+#include "ArticleScorer.h"
+#include "ArticleSet.h"
+#include "GroupListCache.h"
+#include "GroupTable.h"
+#include "MessageDate.h"
 #include "NNTPClientSession.h"
+#include "Newsrc.h"
+#include "OverviewBatch.h"
 
+#include <Poco/Condition.h>
+#include <Poco/DateTime.h>
 #include <Poco/DateTimeFormatter.h>
+#include <Poco/DateTimeParser.h>
+#include <Poco/File.h>
+#include <Poco/FileStream.h>
+#include <Poco/MemoryStream.h>
 #include <Poco/Net/MailMessage.h>
 #include <Poco/NumberParser.h>
+#include <Poco/Mutex.h>
+#include <Poco/Path.h>
 #include <Poco/StringTokenizer.h>
+#include <Poco/TemporaryFile.h>
+#include <Poco/Thread.h>
+#include <Poco/Timestamp.h>
 
 #include <algorithm>
+#include <cstdlib>
+#include <deque>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace
 {
 
+const char *const GROUP_WILDMAT = "gmane.comp.*.boost.*";
+const std::size_t ARTICLE_CACHE_BYTES = 32 * 1024 * 1024;
+const std::size_t PREFETCH_COUNT = 5; // articles fetched ahead of the reader
+const unsigned int OVERVIEW_PAGE = 500; // article numbers per overview request
+const std::size_t MAX_OVERVIEW_PAGES = 64;
+const std::size_t LIST_LINES = 20;      // subjects shown at a time
+
+std::string groupCachePath(const std::string &server)
+{
+    Poco::Path path(Poco::Path::cacheHome());
+    path.pushDirectory("news-reader");
+    path.setFileName(server + ".groups");
+    return path.toString();
+}
+
+std::string newsrcPath()
+{
+    Poco::Path path(Poco::Path::home());
+    path.setFileName(".newsrc");
+    return path.toString();
+}
+
+std::string scoreFilePath()
+{
+    Poco::Path path(Poco::Path::configHome());
+    path.pushDirectory("news-reader");
+    path.setFileName("score");
+    return path.toString();
+}
+
+std::string overviewCachePath(const std::string &server)
+{
+    Poco::Path path(Poco::Path::cacheHome());
+    path.pushDirectory("news-reader");
+    path.pushDirectory(server);
+    return path.toString();
+}
+
+std::string articleKey(const std::string &group, unsigned int number, const std::string &messageId)
+    /// Returns the key an article is cached under: its message-id,
+    /// or its group and number if the overview lacks one.
+{
+    return messageId.empty() ? group + ':' + std::to_string(number) : messageId;
+}
+
+class OverviewIndex
+    /// The overview records of the selected group, loaded lazily in
+    /// pages of OVERVIEW_PAGE article numbers.
+    ///
+    /// Only the pages around what is being viewed are held in memory.
+    /// Pages that lie entirely below the high water mark of the group
+    /// cannot change any more, except for expiry, so they are also kept
+    /// on disk and read from there when the group is opened again.
+{
+  public:
+    using Record = Poco::Net::OverviewRecord;
+
+    OverviewIndex(Poco::Net::NNTPClientSession &session,
+                  const std::string &directory)
+        : m_session(session),
+          m_directory(directory)
+    {
+    }
+
+    void reset(const std::string &group, unsigned int low, unsigned int high)
+    {
+        m_group = group;
+        m_low = low;
+        m_high = high;
+        m_pages.clear();
+    }
+
+    const Record *find(unsigned int number)
+    {
+        if (number < m_low || number > m_high)
+        {
+            return nullptr;
+        }
+        const std::vector<Record> &records = page(number / OVERVIEW_PAGE);
+        auto it = std::lower_bound(records.begin(), records.end(), number, byNumber);
+        return it != records.end() && it->number == number ? &*it : nullptr;
+    }
+
+    const Record *next(unsigned int number)
+        /// Returns the first record after the given article number.
+    {
+        for (unsigned int index = number / OVERVIEW_PAGE;
+             number < m_high && index <= m_high / OVERVIEW_PAGE; ++index)
+        {
+            const std::vector<Record> &records = page(index);
+            auto it = std::upper_bound(records.begin(), records.end(), number,
+                                       [](unsigned int value, const Record &record)
+                                       { return value < record.number; });
+            if (it != records.end())
+            {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    const Record *previous(unsigned int number)
+        /// Returns the last record before the given article number.
+    {
+        for (unsigned int index = number / OVERVIEW_PAGE + 1;
+             number > m_low && index-- > m_low / OVERVIEW_PAGE;)
+        {
+            const std::vector<Record> &records = page(index);
+            auto it = std::lower_bound(records.begin(), records.end(), number, byNumber);
+            if (it != records.begin())
+            {
+                return &*--it;
+            }
+        }
+        return nullptr;
+    }
+
+    unsigned int findDate(const Poco::Timestamp &date)
+        /// Returns the number of the first article posted at or after
+        /// the given date, assuming numbers grow with posting time, or
+        /// one past the high water mark if there is none.
+    {
+        // the answer is either found or lies in [low, high)
+        unsigned int found = m_high + 1;
+        unsigned int low = m_low;
+        unsigned int high = m_high + 1;
+        while (low < high)
+        {
+            const unsigned int middle = low + (high - low) / 2;
+            const Record *record = middle == 0 ? nullptr : next(middle - 1);
+            if (!record || record->number >= high)
+            {
+                high = middle;
+            }
+            else if (timestamp(*record) < date)
+            {
+                low = record->number + 1;
+            }
+            else
+            {
+                found = record->number;
+                high = middle;
+            }
+        }
+        return found;
+    }
+
+    static Poco::Timestamp timestamp(const Record &record)
+    {
+        return Poco::Timestamp(Poco::Net::MessageDate::parse(record.date));
+    }
+
+    unsigned int low() const
+    {
+        return m_low;
+    }
+
+    unsigned int high() const
+    {
+        return m_high;
+    }
+
+  private:
+    static bool byNumber(const Record &record, unsigned int number)
+    {
+        return record.number < number;
+    }
+
+    const std::vector<Record> &page(unsigned int index)
+    {
+        auto it = m_pages.find(index);
+        if (it != m_pages.end())
+        {
+            return it->second;
+        }
+        if (m_pages.size() >= MAX_OVERVIEW_PAGES)
+        {
+            // drop the page farthest from the one wanted
+            auto farthest = std::abs(static_cast<long>(m_pages.begin()->first) - static_cast<long>(index)) >
+                                    std::abs(static_cast<long>(m_pages.rbegin()->first) - static_cast<long>(index))
+                                ? m_pages.begin()
+                                : std::prev(m_pages.end());
+            m_pages.erase(farthest);
+        }
+
+        std::vector<Record> &records = m_pages[index];
+        const unsigned int first = std::max(index * OVERVIEW_PAGE, m_low);
+        const unsigned int last = std::min(index * OVERVIEW_PAGE + OVERVIEW_PAGE - 1, m_high);
+        const bool complete = index * OVERVIEW_PAGE + OVERVIEW_PAGE - 1 < m_high;
+        if (first > last)
+        {
+            return records;
+        }
+        const std::string path = pagePath(index);
+        Record record;
+        if (complete && Poco::File(path).exists())
+        {
+            Poco::FileInputStream in(path);
+            std::string line;
+            while (std::getline(in, line))
+            {
+                if (Poco::Net::NNTPClientSession::parseOverview(line, record) &&
+                    record.number >= first)
+                {
+                    records.push_back(std::move(record));
+                }
+            }
+            return records;
+        }
+
+        std::string lines;
+        m_session.overview(first, last,
+                           [&](const std::string &line)
+                           {
+                               if (Poco::Net::NNTPClientSession::parseOverview(line, record))
+                               {
+                                   records.push_back(std::move(record));
+                                   lines += line;
+                                   lines += '\n';
+                               }
+                           });
+        if (complete)
+        {
+            storePage(path, lines);
+        }
+        return records;
+    }
+
+    void storePage(const std::string &path, const std::string &lines)
+    {
+        try
+        {
+            Poco::File(Poco::Path(path).parent()).createDirectories();
+            const std::string temp = Poco::TemporaryFile::tempName(Poco::Path(path).parent().toString());
+            {
+                Poco::FileOutputStream out(temp, std::ios::trunc);
+                out << lines;
+            }
+            Poco::File(temp).renameTo(path);
+        }
+        catch (const Poco::Exception &)
+        {
+            // the page will simply be fetched again next time
+        }
+    }
+
+    std::string pagePath(unsigned int index) const
+    {
+        Poco::Path path(Poco::Path(m_directory).makeDirectory());
+        path.pushDirectory(m_group);
+        path.setFileName(std::to_string(index) + ".over");
+        return path.toString();
+    }
+
+    Poco::Net::NNTPClientSession &m_session;
+    std::string m_directory;
+    std::string m_group;
+    unsigned int m_low{};
+    unsigned int m_high{};
+    std::map<unsigned int, std::vector<Record>> m_pages;
+};
+
+class Prefetcher
+    /// Fetches the articles the reader is likely to open next into
+    /// the cache, over a connection of its own and on its own thread.
+    ///
+    /// Each schedule() call replaces the pending requests; those of an
+    /// earlier call are dropped without being sent, so jumping around
+    /// the group never leaves a backlog of stale fetches.
+{
+  public:
+    using Request = std::pair<unsigned int, std::string>; // number, articleKey()
+
+    Prefetcher(const std::string &server, Poco::Net::ArticleCache &cache)
+        : m_server(server),
+          m_cache(cache)
+    {
+        m_thread.startFunc([this] { run(); });
+    }
+
+    ~Prefetcher()
+    {
+        {
+            Poco::FastMutex::ScopedLock lock(m_mutex);
+            m_stop = true;
+            m_wakeUp.signal();
+        }
+        m_thread.join();
+    }
+
+    void schedule(const std::string &group, std::vector<Request> requests)
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        m_group = group;
+        m_queue.assign(requests.begin(), requests.end());
+        m_wakeUp.signal();
+    }
+
+    void awaitInFlight(const std::string &key)
+        /// Waits until the article is no longer being fetched, so the
+        /// reader does not fetch the same article a second time.
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        while (m_inFlight == key)
+        {
+            m_fetched.wait(m_mutex);
+        }
+    }
+
+  private:
+    void run()
+    {
+        std::unique_ptr<Poco::Net::NNTPClientSession> session;
+        std::string selected;
+        for (;;)
+        {
+            Request request;
+            std::string group;
+            {
+                Poco::FastMutex::ScopedLock lock(m_mutex);
+                while (m_queue.empty() && !m_stop)
+                {
+                    m_wakeUp.wait(m_mutex);
+                }
+                if (m_stop)
+                {
+                    return;
+                }
+                request = std::move(m_queue.front());
+                m_queue.pop_front();
+                if (m_cache.find(request.second))
+                {
+                    continue;
+                }
+                group = m_group;
+                m_inFlight = request.second;
+            }
+
+            try
+            {
+                if (!session)
+                {
+                    session = std::make_unique<Poco::Net::NNTPClientSession>(m_server);
+                    session->open();
+                    selected.clear();
+                }
+                if (selected != group)
+                {
+                    session->selectNewsGroup(group);
+                    selected = group;
+                }
+                std::string text;
+                session->articleTo(std::to_string(request.first), text);
+                m_cache.add(request.second, std::move(text));
+            }
+            catch (const Poco::Net::NNTPException &)
+            {
+                // the article is gone; the reader will find out itself
+            }
+            catch (const Poco::Exception &)
+            {
+                if (session)
+                {
+                    session->abort();
+                    session.reset();
+                }
+            }
+
+            Poco::FastMutex::ScopedLock lock(m_mutex);
+            m_inFlight.clear();
+            m_fetched.broadcast();
+        }
+    }
+
+    std::string m_server;
+    Poco::Net::ArticleCache &m_cache;
+    Poco::FastMutex m_mutex;
+    Poco::Condition m_wakeUp;
+    Poco::Condition m_fetched;
+    std::deque<Request> m_queue;
+    std::string m_group;
+    std::string m_inFlight;
+    bool m_stop{};
+    Poco::Thread m_thread;
+};
+
 class NewsReader
 {
   public:
-    explicit NewsReader(const std::string &server) : m_session(server)
+    explicit NewsReader(const std::string &server)
+        : m_session(server),
+          m_groupCache(groupCachePath(server), GROUP_WILDMAT),
+          m_groups(m_groupCache.groups()),
+          m_overview(m_session, overviewCachePath(server)),
+          m_cache(ARTICLE_CACHE_BYTES),
+          m_prefetcher(server, m_cache),
+          m_newsrc(newsrcPath())
     {
+        if (Poco::File(scoreFilePath()).exists())
+        {
+            Poco::FileInputStream rules(scoreFilePath());
+            m_scorer.load(rules);
+        }
         m_session.open();
-        m_groupDescs = m_session.listNewsGroups("gmane.comp.*.boost.*");
-        std::sort(
-            m_groupDescs.begin(), m_groupDescs.end(),
-            [](const Poco::Net::GroupDesc &lhs, const Poco::Net::GroupDesc &rhs)
-            { return lhs.first < rhs.first; });
+        m_groupCache.load();
+        m_groupCache.refresh(m_session);
     }
 
     bool selectGroup();
@@ -32,14 +451,37 @@ class NewsReader
     void displayArticle();
 
   private:
-    void getArticles();
+    void scoreGroup();
+    bool shown(unsigned int number) const;
+    const Poco::Net::OverviewRecord *nextShown(unsigned int number);
+    const Poco::Net::OverviewRecord *previousShown(unsigned int number);
+    void showList(unsigned int width);
+    bool pageDown();
+    bool pageUp();
+    void prefetchAfter(unsigned int number);
+    Poco::Net::ArticleCache::Article rawArticle(unsigned int number);
 
     Poco::Net::NNTPClientSession m_session;
-    std::vector<Poco::Net::GroupDesc> m_groupDescs;
+    Poco::Net::GroupListCache m_groupCache;
+    const Poco::Net::GroupTable &m_groups;
     std::string m_currentGroup;
     Poco::Net::ActiveNewsGroup m_activeGroup;
-    std::map<unsigned int, std::unique_ptr<Poco::Net::NewsArticle>> m_articles;
+    OverviewIndex m_overview;
+    unsigned int m_top{}; // first article number shown in the list
+    Poco::Net::ArticleCache m_cache; // raw articles, parsed on demand
+    Prefetcher m_prefetcher;
     unsigned int m_selectedArticle{};
+    Poco::Net::Newsrc m_newsrc;
+    Poco::Net::ArticleSet m_present; // of the current group, by LISTGROUP
+    Poco::Net::ArticleSet m_unread; // of the current group
+    Poco::Net::ArticleScorer m_scorer;
+    Poco::Net::OverviewBatch m_scored;  // the whole group, when there are rules
+    std::vector<std::size_t> m_ranked;  // rows of m_scored by falling score, killed ones left out
+    std::vector<int> m_scores;
+    std::vector<Poco::Timestamp::TimeVal> m_times; // of the rows of m_scored
+    Poco::Net::ArticleSet m_killed;
+    bool m_byScore{};
+    std::size_t m_rankTop{}; // first row of m_ranked shown
 };
 
 bool NewsReader::selectGroup()
@@ -47,90 +489,285 @@ bool NewsReader::selectGroup()
     int group;
     do
     {
-        int i = 1;
-        auto pos = std::max_element(
-            m_groupDescs.begin(), m_groupDescs.end(),
-            [](const Poco::Net::GroupDesc &lhs, const Poco::Net::GroupDesc &rhs)
-            { return lhs.first.size() < rhs.first.size(); });
-        unsigned int maxLength = pos->first.size() + 1;
-        for (const Poco::Net::GroupDesc &groupDesc : m_groupDescs)
+        const std::size_t maxLength = m_groups.maxNameLength() + 1;
+        for (std::size_t i = 0; i < m_groups.size(); ++i)
         {
-            std::cout << std::setw(3) << std::setfill(' ') << i << ' '
-                      << groupDesc.first
-                      << std::string(maxLength - groupDesc.first.size(), ' ')
-                      << groupDesc.second << '\n';
-            ++i;
+            const std::string_view name = m_groups.name(i);
+            const std::size_t unread = m_newsrc.unreadCount(
+                std::string(name), m_groups.lowArticle(i), m_groups.highArticle(i));
+            std::cout << std::setw(3) << std::setfill(' ') << i + 1 << ' '
+                      << name << std::string(maxLength - name.size(), ' ')
+                      << std::setw(7) << unread << ' '
+                      << m_groups.description(i) << '\n';
         }
         std::cout << std::setw(3) << std::setfill(' ') << 'q' << " - Quit\n";
         std::string cmd;
         std::getline(std::cin, cmd);
-        if (cmd == "q")
+        if (cmd == "q" || !std::cin)
+        {
+            m_newsrc.save();
             return false;
+        }
 
         group = Poco::NumberParser::parse(cmd);
-    } while (group < 1 || group > static_cast<int>(m_groupDescs.size()));
-    m_currentGroup = m_groupDescs[group - 1].first;
-    m_activeGroup = m_session.selectNewsGroup(m_currentGroup);
-    getArticles();
+    } while (group < 1 || group > static_cast<int>(m_groups.size()));
+    m_currentGroup = m_groups.name(group - 1);
+    // LISTGROUP gives the articles actually present, so the unread
+    // set is exact even in groups full of expired or cancelled ones,
+    // and cached overview pages can be checked against it
+    m_present.clear();
+    m_activeGroup = m_session.listGroup(m_currentGroup, m_present);
+    m_unread.clear();
+    m_unread |= m_present;
+    m_unread -= m_newsrc.read(m_currentGroup);
+    m_overview.reset(m_currentGroup, m_activeGroup.lowArticle,
+                     m_activeGroup.highArticle);
+    const unsigned int firstUnread = m_unread.next(m_activeGroup.lowArticle);
+    m_top = firstUnread != 0 ? firstUnread : m_activeGroup.lowArticle;
+    scoreGroup();
+    std::cout << m_unread.count() << " unread";
+    if (!m_killed.empty())
+        std::cout << ", " << m_killed.count() << " killed";
+    std::cout << '\n';
 
     return true;
 }
 
 bool NewsReader::selectArticle()
 {
-    unsigned int number;
-    do
+    // only the visible window of the list is fetched and formatted
+    const unsigned int width = std::to_string(m_overview.high()).size() + 1;
+    for (;;)
     {
-        using NumberArticle =
-            std::pair<const unsigned int,
-                      std::unique_ptr<Poco::Net::NewsArticle>>;
-        auto pos = std::max_element(
-            m_articles.begin(), m_articles.end(),
-            [](const NumberArticle &lhs, const NumberArticle &rhs)
-            {
-                return std::to_string(lhs.first).size() <
-                       std::to_string(rhs.first).size();
-            });
-        unsigned int maxLength = std::to_string(pos->first).size() + 1;
-        for (const auto &article : m_articles)
-        {
-            std::cout << std::setw(maxLength) << std::setfill(' ')
-                      << article.first << ' ' << article.second->getSubject()
-                      << '\n';
-        }
-        std::cout << std::setw(maxLength) << std::setfill(' ') << 'q'
-                  << " - Quit\n";
+        showList(width);
+        std::cout << std::setw(width) << std::setfill(' ') << 'q'
+                  << " - Quit, n/p - Next/previous page, g <number>, d <yyyy-mm-dd>,"
+                     " c - Mark all read, s - Sort by score/number\n";
         std::string cmd;
         std::getline(std::cin, cmd);
-        if (cmd == "q")
+        if (cmd == "q" || !std::cin)
             return false;
+        if (cmd.empty() || cmd == "n")
+        {
+            pageDown();
+        }
+        else if (cmd == "p")
+        {
+            pageUp();
+        }
+        else if (cmd == "s")
+        {
+            m_byScore = !m_byScore && !m_ranked.empty();
+            m_rankTop = 0;
+        }
+        else if (cmd == "c")
+        {
+            m_newsrc.markRead(m_currentGroup, m_overview.low(), m_overview.high());
+            m_unread.clear();
+        }
+        else if (cmd.size() > 2 && cmd.compare(0, 2, "g ") == 0)
+        {
+            unsigned int number;
+            if (Poco::NumberParser::tryParseUnsigned(cmd.substr(2), number))
+                m_top = std::max(number, m_overview.low());
+        }
+        else if (cmd.size() > 2 && cmd.compare(0, 2, "d ") == 0)
+        {
+            Poco::DateTime date;
+            int tzd;
+            if (Poco::DateTimeParser::tryParse("%Y-%m-%d", cmd.substr(2), date, tzd))
+                m_top = m_overview.findDate(date.timestamp());
+        }
+        else
+        {
+            unsigned int number;
+            if (Poco::NumberParser::tryParseUnsigned(cmd, number) && shown(number) && m_overview.find(number))
+            {
+                m_selectedArticle = number;
+                prefetchAfter(number);
+                return true;
+            }
+        }
+    }
+}
 
-        number = Poco::NumberParser::parseUnsigned(cmd);
-    } while (m_articles.find(number) == m_articles.end());
+void NewsReader::scoreGroup()
+{
+    // the rules need the whole group at once, which also gives the
+    // ranking; without rules the overview stays lazily loaded
+    m_scored.clear();
+    m_ranked.clear();
+    m_killed.clear();
+    m_byScore = false;
+    if (m_scorer.size() == 0 || m_activeGroup.lowArticle > m_activeGroup.highArticle)
+        return;
 
-    m_selectedArticle = number;
-    return true;
+    m_session.overview(m_activeGroup.lowArticle, m_activeGroup.highArticle, m_scored);
+    m_scorer.score(m_currentGroup, m_scored, m_scores);
+    m_scored.timestamps(m_times);
+    for (std::size_t i = 0; i < m_scored.size(); ++i)
+    {
+        if (Poco::Net::ArticleScorer::killed(m_scores[i]))
+            m_killed.add(m_scored.number(i));
+        else
+            m_ranked.push_back(i);
+    }
+    // equal scores list the newest articles first
+    std::sort(m_ranked.begin(), m_ranked.end(),
+              [this](std::size_t a, std::size_t b)
+              {
+                  return m_scores[a] != m_scores[b] ? m_scores[a] > m_scores[b]
+                                                    : m_times[a] > m_times[b];
+              });
+}
+
+bool NewsReader::shown(unsigned int number) const
+{
+    // cached overview pages still list articles expired since
+    return m_present.contains(number) && !m_killed.contains(number);
+}
+
+const Poco::Net::OverviewRecord *NewsReader::nextShown(unsigned int number)
+{
+    const Poco::Net::OverviewRecord *record = m_overview.next(number);
+    while (record && !shown(record->number))
+        record = m_overview.next(record->number);
+    return record;
 }
 
-void NewsReader::getArticles()
+const Poco::Net::OverviewRecord *NewsReader::previousShown(unsigned int number)
 {
-    m_articles.clear();
+    const Poco::Net::OverviewRecord *record = m_overview.previous(number);
+    while (record && !shown(record->number))
+        record = m_overview.previous(record->number);
+    return record;
+}
 
-    for (unsigned int number = m_activeGroup.lowArticle, count = 0;
-         number <= m_activeGroup.highArticle && count < 10; ++number)
+void NewsReader::showList(unsigned int width)
+{
+    if (m_byScore)
     {
-        if (m_session.stat(number))
+        for (std::size_t i = m_rankTop; i < m_ranked.size() && i < m_rankTop + LIST_LINES; ++i)
         {
-            ++count;
-            m_articles[number] = std::make_unique<Poco::Net::NewsArticle>();
-            m_session.article(number, *m_articles[number]);
+            const std::size_t row = m_ranked[i];
+            std::cout << std::setw(width) << std::setfill(' ') << m_scored.number(row)
+                      << (m_unread.contains(m_scored.number(row)) ? " * " : "   ")
+                      << std::setw(5) << m_scores[row] << ' '
+                      << m_scored.subject(row) << '\n';
         }
+        return;
+    }
+
+    const Poco::Net::OverviewRecord *record =
+        m_top == 0 ? nullptr : nextShown(m_top - 1);
+    for (std::size_t i = 0; record && i < LIST_LINES; ++i)
+    {
+        std::cout << std::setw(width) << std::setfill(' ') << record->number
+                  << (m_unread.contains(record->number) ? " * " : "   ")
+                  << record->subject << '\n';
+        record = nextShown(record->number);
+    }
+}
+
+bool NewsReader::pageDown()
+{
+    if (m_byScore)
+    {
+        if (m_rankTop + LIST_LINES >= m_ranked.size())
+            return false;
+        m_rankTop += LIST_LINES;
+        return true;
+    }
+
+    const Poco::Net::OverviewRecord *record =
+        m_top == 0 ? nullptr : nextShown(m_top - 1);
+    for (std::size_t i = 0; record && i < LIST_LINES; ++i)
+    {
+        const Poco::Net::OverviewRecord *next = nextShown(record->number);
+        if (!next)
+            return false;
+        record = next;
+    }
+    if (!record)
+        return false;
+    m_top = record->number;
+    return true;
+}
+
+bool NewsReader::pageUp()
+{
+    if (m_byScore)
+    {
+        const std::size_t top = m_rankTop > LIST_LINES ? m_rankTop - LIST_LINES : 0;
+        const bool moved = top != m_rankTop;
+        m_rankTop = top;
+        return moved;
+    }
+
+    unsigned int top = m_top;
+    for (std::size_t i = 0; i < LIST_LINES; ++i)
+    {
+        const Poco::Net::OverviewRecord *previous = previousShown(top);
+        if (!previous)
+            break;
+        top = previous->number;
+    }
+    const bool moved = top != m_top;
+    m_top = top;
+    return moved;
+}
+
+void NewsReader::prefetchAfter(unsigned int number)
+{
+    // the articles following the selected one in display order
+    std::vector<Prefetcher::Request> requests;
+    for (const Poco::Net::OverviewRecord *record = nextShown(number);
+         record && requests.size() < PREFETCH_COUNT;
+         record = nextShown(record->number))
+    {
+        requests.emplace_back(record->number, articleKey(m_currentGroup, record->number, record->messageId));
     }
+    m_prefetcher.schedule(m_currentGroup, std::move(requests));
+}
+
+Poco::Net::ArticleCache::Article NewsReader::rawArticle(unsigned int number)
+{
+    const Poco::Net::OverviewRecord *record = m_overview.find(number);
+    const std::string key =
+        articleKey(m_currentGroup, number, record ? record->messageId : std::string());
+    m_prefetcher.awaitInFlight(key);
+    Poco::Net::ArticleCache::Article article = m_cache.find(key);
+    if (!article)
+    {
+        std::string text;
+        m_session.articleTo(std::to_string(number), text);
+        article = m_cache.add(key, std::move(text));
+    }
+    return article;
 }
 
 void NewsReader::displayArticle()
 {
-    const Poco::Net::NewsArticle &article = *m_articles[m_selectedArticle];
+    Poco::Net::ArticleCache::Article raw;
+    try
+    {
+        raw = rawArticle(m_selectedArticle);
+    }
+    catch (const Poco::Net::NNTPException &bang)
+    {
+        // expired or cancelled since the group was selected
+        if (bang.code() != 423 && bang.code() != 430)
+            throw;
+        std::cout << "Article " << m_selectedArticle << " is no longer available\n";
+        m_present.remove(m_selectedArticle);
+        m_unread.remove(m_selectedArticle);
+        return;
+    }
+    m_newsrc.markRead(m_currentGroup, m_selectedArticle);
+    m_unread.remove(m_selectedArticle);
+    Poco::MemoryInputStream stream(raw->data(), raw->size());
+    Poco::Net::NewsArticle article;
+    article.read(stream);
     std::cout << "        From: " << article.getSender() << '\n'
               << "     Subject: " << article.getSubject() << '\n'
               << "        Date: "
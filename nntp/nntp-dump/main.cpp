@@ -1,89 +1,580 @@
-#include <iostream>
-
+#include "ArticleSpool.h"
+#include "GroupTable.h"
 #include "NNTPClientSession.h"
-#include "Poco/Net/MailMessage.h"
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/FileStream.h>
+#include <Poco/Mutex.h>
+#include <Poco/Path.h>
+#include <Poco/TemporaryFile.h>
+#include <Poco/Thread.h>
+#include <Poco/Timestamp.h>
+#include <Poco/Util/Application.h>
+#include <Poco/Util/HelpFormatter.h>
+#include <Poco/Util/Option.h>
+#include <Poco/Util/OptionSet.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace {
 
-void print(const std::vector<std::string> &lines)
+using Poco::Net::uint_t;
+
+const uint_t CHUNK_SIZE = 1000;            // articles per initial work range
+const uint_t MIN_STEAL = 16;               // smallest range worth splitting
+const uint_t CHECKPOINT_INTERVAL = 100;    // articles between checkpoints
+const Poco::UInt64 SEGMENT_SIZE = 1 << 30; // spool segment roll-over size
+const int MAX_FAILURES = 5;                // consecutive failures before a worker gives up
+const long RETRY_DELAY_MS = 2000;
+
+struct Range
 {
-    for (const std::string &line : lines)
+    std::size_t group{};
+    uint_t next{}; // first article not yet claimed
+    uint_t last{}; // last article in the range
+};
+
+class WorkQueue
+    /// Article ranges shared by the workers.
+    ///
+    /// Each worker owns one range at a time and claims its articles
+    /// one by one. Once the pending ranges run out, an idle worker
+    /// steals the upper half of the largest range still owned by
+    /// another worker, so all connections stay busy until the end.
+{
+  public:
+    explicit WorkQueue(std::size_t workers) : m_owned(workers)
     {
-        std::cout << line << '\n';
     }
-}
 
-void print(const Poco::Net::NewsArticle &article)
-{
-    std::cout << "From:    " << article.getSender() << '\n';
-    std::cout << "Subject: " << article.getSubject() << '\n';
-    std::cout << "Type:    " << article.getContentType() << '\n';
-    std::cout << '\n';
-    std::cout << article.getContent() << '\n';
-}
+    void add(std::size_t group, uint_t low, uint_t high)
+    {
+        for (uint_t first = low; first <= high && first != 0;)
+        {
+            const uint_t last = high - first < CHUNK_SIZE ? high : first + CHUNK_SIZE - 1;
+            m_pending.push_back(Range{group, first, last});
+            m_total += last - first + 1;
+            if (last == high)
+            {
+                break;
+            }
+            first = last + 1;
+        }
+    }
 
-void print(const Poco::Net::GroupDesc &desc)
-{
-    std::cout << desc.first << ' ' << desc.second << '\n';
-}
+    bool take(std::size_t worker, Range &range)
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        if (!m_pending.empty())
+        {
+            m_owned[worker] = m_pending.front();
+            m_pending.pop_front();
+        }
+        else if (!steal(worker))
+        {
+            m_owned[worker] = Range{0, 1, 0};
+            return false;
+        }
+        range = m_owned[worker];
+        return true;
+    }
 
-void print(const std::vector<Poco::Net::GroupDesc> &descs)
-{
-    for (const Poco::Net::GroupDesc &desc : descs)
+    bool claim(std::size_t worker, uint_t number)
+        /// Claims the given article of the worker's range; returns
+        /// false if it has been stolen or the range is finished.
     {
-        print(desc);
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        Range &owned = m_owned[worker];
+        if (number != owned.next || owned.next > owned.last || owned.next == 0)
+        {
+            return false;
+        }
+        ++owned.next;
+        return true;
     }
-}
 
-void separator()
+    void release(std::size_t worker, uint_t number)
+        /// Returns the unfinished part of the worker's range, starting
+        /// at the given article, to the pending ranges.
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        Range &owned = m_owned[worker];
+        if (number <= owned.last)
+        {
+            m_pending.push_front(Range{owned.group, number, owned.last});
+        }
+        owned = Range{0, 1, 0};
+    }
+
+    Poco::UInt64 total() const
+    {
+        return m_total;
+    }
+
+  private:
+    bool steal(std::size_t thief)
+    {
+        std::size_t victim = m_owned.size();
+        uint_t largest = 0;
+        for (std::size_t i = 0; i < m_owned.size(); ++i)
+        {
+            const Range &range = m_owned[i];
+            if (range.next <= range.last && range.last - range.next + 1 > largest)
+            {
+                largest = range.last - range.next + 1;
+                victim = i;
+            }
+        }
+        if (victim == m_owned.size() || largest < MIN_STEAL)
+        {
+            return false;
+        }
+
+        Range &range = m_owned[victim];
+        const uint_t middle = range.next + largest / 2;
+        m_owned[thief] = Range{range.group, middle, range.last};
+        range.last = middle - 1;
+        return true;
+    }
+
+    Poco::FastMutex m_mutex;
+    std::deque<Range> m_pending;
+    std::vector<Range> m_owned;
+    Poco::UInt64 m_total{};
+};
+
+class Checkpoint
+    /// A journal of the article ranges already archived, one
+    /// "group low high" line per range. It is compacted on load and
+    /// appended to as workers make progress.
 {
-    std::cout << std::string(70, '=') << "\n\n";
-}
+  public:
+    explicit Checkpoint(const std::string &path) : m_path(path)
+    {
+    }
 
-}
+    void load()
+    {
+        if (Poco::File(m_path).exists())
+        {
+            Poco::FileInputStream in(m_path);
+            std::string group;
+            uint_t low;
+            uint_t high;
+            while (in >> group >> low >> high)
+            {
+                m_done[group].emplace_back(low, high);
+            }
+        }
+        for (auto &group : m_done)
+        {
+            merge(group.second);
+        }
 
-int main(int argc, char **argv)
+        // rewrite the journal in its compacted form
+        const std::string temp = Poco::TemporaryFile::tempName(Poco::Path(m_path).parent().toString());
+        {
+            Poco::FileOutputStream out(temp, std::ios::trunc);
+            for (const auto &group : m_done)
+            {
+                for (const auto &range : group.second)
+                {
+                    out << group.first << ' ' << range.first << ' ' << range.second << '\n';
+                }
+            }
+        }
+        Poco::File(temp).renameTo(m_path);
+        m_journal.reset(new Poco::FileOutputStream(m_path, std::ios::app));
+    }
+
+    std::vector<std::pair<uint_t, uint_t>> remaining(const std::string &group, uint_t low, uint_t high) const
+        /// Returns the parts of [low, high] not archived yet.
+    {
+        std::vector<std::pair<uint_t, uint_t>> result;
+        auto it = m_done.find(group);
+        uint_t next = low;
+        if (it != m_done.end())
+        {
+            for (const auto &range : it->second)
+            {
+                if (range.second < next || range.first > high)
+                {
+                    continue;
+                }
+                if (range.first > next)
+                {
+                    result.emplace_back(next, range.first - 1);
+                }
+                next = range.second + 1;
+                if (range.second >= high)
+                {
+                    return result;
+                }
+            }
+        }
+        if (next <= high)
+        {
+            result.emplace_back(next, high);
+        }
+        return result;
+    }
+
+    void record(const std::string &group, uint_t low, uint_t high)
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        *m_journal << group << ' ' << low << ' ' << high << '\n';
+        m_journal->flush();
+    }
+
+  private:
+    static void merge(std::vector<std::pair<uint_t, uint_t>> &ranges)
+    {
+        std::sort(ranges.begin(), ranges.end());
+        std::vector<std::pair<uint_t, uint_t>> merged;
+        for (const auto &range : ranges)
+        {
+            if (!merged.empty() && range.first <= merged.back().second + 1)
+            {
+                merged.back().second = std::max(merged.back().second, range.second);
+            }
+            else
+            {
+                merged.push_back(range);
+            }
+        }
+        ranges.swap(merged);
+    }
+
+    std::string m_path;
+    std::map<std::string, std::vector<std::pair<uint_t, uint_t>>> m_done;
+    Poco::FastMutex m_mutex;
+    std::unique_ptr<Poco::FileOutputStream> m_journal;
+};
+
+class NNTPDump : public Poco::Util::Application
+    /// Archives the newsgroups matching a wildmat to local spool
+    /// segments over several parallel connections, resuming from
+    /// the checkpoint journal after an interruption.
 {
-    try
+  protected:
+    void initialize(Application &self) override
     {
-        Poco::Net::NNTPClientSession session("news.gmane.io");
-        session.open();
+        loadConfiguration(); // load default configuration files, if present
+        Application::initialize(self);
+    }
 
-        print(session.capabilities());
-        separator();
+    void defineOptions(Poco::Util::OptionSet &options) override
+    {
+        Application::defineOptions(options);
 
-        print(session.listNewsGroups("gmane.comp.*.boost.*"));
-        separator();
+        options.addOption(
+            Poco::Util::Option("help", "h", "display help information")
+                .required(false)
+                .repeatable(false));
+        options.addOption(
+            Poco::Util::Option("server", "s", "news server")
+                .argument("host")
+                .binding("NNTPDump.server"));
+        options.addOption(
+            Poco::Util::Option("port", "p", "news server port")
+                .argument("port")
+                .binding("NNTPDump.port"));
+        options.addOption(
+            Poco::Util::Option("user", "u", "user name for AUTHINFO USER/PASS")
+                .argument("name")
+                .binding("NNTPDump.username"));
+        options.addOption(
+            Poco::Util::Option("password", "w", "password for AUTHINFO USER/PASS")
+                .argument("password")
+                .binding("NNTPDump.password"));
+        options.addOption(
+            Poco::Util::Option("groups", "g", "wildmat of the groups to archive")
+                .argument("wildmat")
+                .binding("NNTPDump.groups"));
+        options.addOption(Poco::Util::Option("connections", "c",
+                                             "number of parallel connections")
+                              .argument("count")
+                              .binding("NNTPDump.connections"));
+        options.addOption(
+            Poco::Util::Option("directory", "d", "spool directory")
+                .argument("path")
+                .binding("NNTPDump.directory"));
+        options.addOption(
+            Poco::Util::Option("train", "t",
+                               "train a compression dictionary for new groups from count articles")
+                .argument("count")
+                .binding("NNTPDump.train"));
+    }
 
-        session.selectNewsGroup("gmane.comp.lib.boost.user");
-        separator();
+    void handleOption(const std::string &name,
+                      const std::string &value) override
+    {
+        Application::handleOption(name, value);
+
+        if (name == "help")
+        {
+            m_helpRequested = true;
+            stopOptionsProcessing();
+        }
+    }
 
-        print(session.articleHeader());
-        separator();
+    int main(const std::vector<std::string> &) override
+    {
+        if (m_helpRequested)
+        {
+            Poco::Util::HelpFormatter helpFormatter(options());
+            helpFormatter.setCommand(commandName());
+            helpFormatter.setUsage("OPTIONS");
+            helpFormatter.setHeader("Archives newsgroups to local spool segments.");
+            helpFormatter.format(std::cout);
+            return EXIT_OK;
+        }
 
-        print(session.articleRaw());
-        separator();
+        m_server = config().getString("NNTPDump.server", "news.gmane.io");
+        m_port = static_cast<Poco::UInt16>(config().getInt(
+            "NNTPDump.port", Poco::Net::NNTPClientSession::NNTP_PORT));
+        m_username = config().getString("NNTPDump.username", "");
+        m_password = config().getString("NNTPDump.password", "");
+        const std::string wildMat = config().getString("NNTPDump.groups", "gmane.comp.lib.boost.user");
+        const std::size_t connections =
+            static_cast<std::size_t>(std::max(config().getInt("NNTPDump.connections", 4), 1));
+        const std::string directory = config().getString("NNTPDump.directory", "spool");
+        const int train = config().getInt("NNTPDump.train", 0);
 
-        Poco::Net::NewsArticle article;
-        session.article(article);
-        print(article);
-        separator();
+        Poco::Net::ArticleSpool spool(directory);
+        Checkpoint checkpoint(Poco::Path(Poco::Path(directory).makeDirectory(), "checkpoint").toString());
+        checkpoint.load();
+
+        {
+            Poco::Net::NNTPClientSession session(m_server, m_port);
+            login(session);
+            session.listActive(wildMat, m_groups);
+            m_groups.sort();
+            if (train > 0)
+            {
+                trainDictionaries(session, spool, static_cast<uint_t>(train));
+            }
+            session.close();
+        }
+
+        WorkQueue work(connections);
+        for (std::size_t i = 0; i < m_groups.size(); ++i)
+        {
+            const uint_t low = m_groups.lowArticle(i);
+            const uint_t high = m_groups.highArticle(i);
+            if (low == 0 || high < low)
+            {
+                continue;
+            }
+            for (const auto &range : checkpoint.remaining(std::string(m_groups.name(i)), low, high))
+            {
+                work.add(i, range.first, range.second);
+            }
+        }
+        logger().information(std::to_string(m_groups.size()) + " groups, " +
+                             std::to_string(work.total()) + " articles to archive");
+
+        std::vector<std::unique_ptr<Poco::Thread>> threads;
+        std::atomic<std::size_t> running{connections};
+        for (std::size_t i = 0; i < connections; ++i)
+        {
+            threads.emplace_back(new Poco::Thread);
+            threads.back()->startFunc([this, i, &work, &checkpoint, &spool, &running] {
+                worker(i, work, checkpoint, spool);
+                --running;
+            });
+        }
+
+        const Poco::Timestamp started;
+        while (running > 0)
+        {
+            Poco::Thread::sleep(1000);
+            report(work.total(), started);
+        }
+        for (const std::unique_ptr<Poco::Thread> &thread : threads)
+        {
+            thread->join();
+        }
+        report(work.total(), started);
+        std::cerr << '\n';
+        return m_processed == work.total() ? EXIT_OK : EXIT_TEMPFAIL;
+    }
+
+  private:
+    void login(Poco::Net::NNTPClientSession &session)
+    {
+        session.login(m_username.empty() ? Poco::Net::NNTPClientSession::AUTH_NONE : Poco::Net::NNTPClientSession::AUTH_LOGIN,
+                      m_username, m_password);
+    }
+
+    void trainDictionaries(Poco::Net::NNTPClientSession &session, Poco::Net::ArticleSpool &spool, uint_t count)
+        /// Builds dictionaries for groups that have none from the
+        /// headers of their latest articles.
+    {
+        for (std::size_t i = 0; i < m_groups.size(); ++i)
+        {
+            const std::string group(m_groups.name(i));
+            if (spool.hasDictionary(group) || m_groups.highArticle(i) < m_groups.lowArticle(i))
+            {
+                continue;
+            }
+            session.selectNewsGroup(group);
+            std::vector<std::string> samples;
+            const uint_t high = m_groups.highArticle(i);
+            for (uint_t number = high; number >= m_groups.lowArticle(i) && number != 0 && high - number < count; --number)
+            {
+                std::string text;
+                try
+                {
+                    session.articleTo(std::to_string(number), text);
+                    samples.push_back(std::move(text));
+                }
+                catch (const Poco::Net::NNTPException &)
+                {
+                }
+            }
+            if (samples.size() > 1)
+            {
+                spool.setDictionary(group, Poco::Net::ArticleSpool::trainDictionary(samples));
+            }
+        }
     }
-    catch (const Poco::Exception &bang)
+
+    void worker(std::size_t index, WorkQueue &work, Checkpoint &checkpoint, Poco::Net::ArticleSpool &spool)
     {
-        std::cerr << "Poco Exception: " << bang.what() << '\n';
-        return 1;
+        std::unique_ptr<Poco::Net::ArticleSpool::Writer> writer;
+        std::string text;
+        std::unique_ptr<Poco::Net::NNTPClientSession> session;
+        std::size_t selected = m_groups.size();
+        int failures = 0;
+        Range range;
+        while (work.take(index, range))
+        {
+            const std::string group(m_groups.name(range.group));
+            uint_t first = range.next; // first article not yet checkpointed
+            uint_t number = range.next;
+            while (work.claim(index, number))
+            {
+                try
+                {
+                    if (!session)
+                    {
+                        session.reset(new Poco::Net::NNTPClientSession(m_server, m_port));
+                        login(*session);
+                        selected = m_groups.size();
+                    }
+                    if (selected != range.group)
+                    {
+                        session->selectNewsGroup(group);
+                        selected = range.group;
+                    }
+                    try
+                    {
+                        text.clear();
+                        m_bytes += static_cast<Poco::UInt64>(session->articleTo(std::to_string(number), text));
+                        if (!writer || writer->size() >= SEGMENT_SIZE)
+                        {
+                            writer = spool.createWriter();
+                        }
+                        writer->append(group, number, text);
+                    }
+                    catch (const Poco::Net::NNTPException &bang)
+                    {
+                        if (bang.code() != 423 && bang.code() != 430)
+                        {
+                            throw;
+                        }
+                        ++m_missing;
+                    }
+                    failures = 0;
+                }
+                catch (const Poco::Exception &bang)
+                {
+                    // checkpoint what is done, hand the rest back and reconnect
+                    logger().warning(group + ' ' + std::to_string(number) + ": " + bang.displayText());
+                    if (session)
+                    {
+                        session->abort();
+                        session.reset();
+                    }
+                    if (number > first)
+                    {
+                        flushSpool(writer);
+                        checkpoint.record(group, first, number - 1);
+                        first = number;
+                    }
+                    work.release(index, number);
+                    if (++failures == MAX_FAILURES)
+                    {
+                        return;
+                    }
+                    Poco::Thread::sleep(RETRY_DELAY_MS);
+                    break;
+                }
+
+                ++m_processed;
+                if (++number - first >= CHECKPOINT_INTERVAL)
+                {
+                    flushSpool(writer);
+                    checkpoint.record(group, first, number - 1);
+                    first = number;
+                }
+            }
+            if (number > first)
+            {
+                flushSpool(writer);
+                checkpoint.record(group, first, number - 1);
+            }
+        }
     }
-    catch (const std::exception &bang)
+
+    static void flushSpool(std::unique_ptr<Poco::Net::ArticleSpool::Writer> &writer)
     {
-        std::cerr << "Exception: " << bang.what() << '\n';
-        return 1;
+        if (writer)
+        {
+            writer->flush();
+        }
     }
-    catch (...)
+
+    void report(Poco::UInt64 total, const Poco::Timestamp &started)
     {
-        std::cerr << "Unknown error\n";
-        return 1;
+        const double seconds = std::max(static_cast<double>(started.elapsed()) / Poco::Timestamp::resolution(), 1e-3);
+        const Poco::UInt64 processed = m_processed;
+        const double rate = processed / seconds;
+        const long eta = rate > 0 ? static_cast<long>((total - processed) / rate) : 0;
+        char line[160];
+        std::snprintf(line, sizeof(line), "\r%llu/%llu articles, %llu missing, %.1f MB, %.1f articles/s, %.2f MB/s, ETA %ld:%02ld:%02ld ",
+                      static_cast<unsigned long long>(processed), static_cast<unsigned long long>(total),
+                      static_cast<unsigned long long>(m_missing.load()), m_bytes / 1048576.0, rate,
+                      m_bytes / 1048576.0 / seconds, eta / 3600, eta / 60 % 60, eta % 60);
+        std::cerr << line << std::flush;
     }
 
-    return 0;
+    bool m_helpRequested{};
+    std::string m_server;
+    Poco::UInt16 m_port{};
+    std::string m_username;
+    std::string m_password;
+    Poco::Net::GroupTable m_groups;
+    std::atomic<Poco::UInt64> m_processed{};
+    std::atomic<Poco::UInt64> m_missing{};
+    std::atomic<Poco::UInt64> m_bytes{};
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    NNTPDump app;
+    return app.run(argc, argv);
 }
@@ -0,0 +1,636 @@
+#include "ArticleCache.h"
+#include "NNTPClientSession.h"
+#include "NNTPSessionPool.h"
+
+#include <Poco/Condition.h>
+#include <Poco/Exception.h>
+#include <Poco/Mutex.h>
+#include <Poco/Net/DialogSocket.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/TCPServer.h>
+#include <Poco/Net/TCPServerConnection.h>
+#include <Poco/Net/TCPServerConnectionFactory.h>
+#include <Poco/Net/TCPServerParams.h>
+#include <Poco/NumberParser.h>
+#include <Poco/String.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/Util/HelpFormatter.h>
+#include <Poco/Util/Option.h>
+#include <Poco/Util/OptionSet.h>
+#include <Poco/Util/ServerApplication.h>
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using Poco::Net::ArticleCache;
+using Poco::Net::NNTPException;
+using Poco::Net::NNTPSessionPool;
+using Poco::Net::uint_t;
+
+std::string upstreamResponse(const NNTPException &bang)
+    /// Returns the upstream status line carried by the exception,
+    /// whose message reads e.g. "Cannot set newsgroup: 411 No such group".
+{
+    const std::string code = std::to_string(bang.code());
+    const std::string &message = bang.message();
+    const std::string::size_type pos = message.find(": " + code);
+    if (pos != std::string::npos)
+        return message.substr(pos + 2);
+    return code + ' ' + message;
+}
+
+class SingleFlight
+    /// Coalesces concurrent fetches of the same key into one call.
+    ///
+    /// The first caller for a key runs the fetch; callers arriving
+    /// while it is in progress wait for and share its result,
+    /// including any exception it throws.
+{
+  public:
+    using Fetch = std::function<ArticleCache::Article()>;
+
+    ArticleCache::Article run(const std::string &key, const Fetch &fetch);
+
+  private:
+    struct Call
+    {
+        bool finished{};
+        ArticleCache::Article article;
+        std::unique_ptr<Poco::Exception> error;
+    };
+
+    Poco::FastMutex m_mutex;
+    Poco::Condition m_finished;
+    std::map<std::string, std::shared_ptr<Call>> m_calls;
+};
+
+ArticleCache::Article SingleFlight::run(const std::string &key,
+                                        const Fetch &fetch)
+{
+    std::shared_ptr<Call> call;
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        auto it = m_calls.find(key);
+        if (it != m_calls.end())
+        {
+            call = it->second;
+            while (!call->finished)
+                m_finished.wait(m_mutex);
+            if (call->error)
+                call->error->rethrow();
+            return call->article;
+        }
+        call = std::make_shared<Call>();
+        m_calls.emplace(key, call);
+    }
+
+    ArticleCache::Article article;
+    std::unique_ptr<Poco::Exception> error;
+    try
+    {
+        article = fetch();
+    }
+    catch (const Poco::Exception &bang)
+    {
+        error.reset(bang.clone());
+    }
+    catch (const std::exception &bang)
+    {
+        error = std::make_unique<Poco::RuntimeException>(bang.what());
+    }
+
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        call->article = article;
+        call->error = std::move(error);
+        call->finished = true;
+        m_calls.erase(key);
+        m_finished.broadcast();
+        if (call->error)
+            call->error->rethrow();
+    }
+    return article;
+}
+
+std::string joinLines(const std::vector<std::string> &lines)
+{
+    std::string::size_type size = 0;
+    for (const std::string &line : lines)
+        size += line.size() + 2;
+
+    std::string text;
+    text.reserve(size);
+    for (const std::string &line : lines)
+    {
+        text += line;
+        text += "\r\n";
+    }
+    return text;
+}
+
+class Upstream
+    /// Access to the upstream server through pooled sessions,
+    /// backed by the shared article cache.
+{
+  public:
+    Upstream(const std::string &host, Poco::UInt16 port, std::size_t sessions,
+             std::size_t cacheBytes, const std::string &cacheDirectory,
+             Poco::UInt64 cacheDiskBytes)
+        : m_pool(host, port, sessions),
+          m_cache(cacheBytes, cacheDirectory, cacheDiskBytes)
+    {
+    }
+
+    ArticleCache::Article article(const std::string &messageId);
+        /// Returns the article from the cache, or fetches it from
+        /// upstream. Throws NNTPException with status 430 if the
+        /// article does not exist.
+
+    Poco::Net::ActiveNewsGroup group(const std::string &name);
+    std::string messageId(const std::string &group, uint_t number);
+        /// Returns the message-id of the given article, or an empty
+        /// string if the group has no article with that number.
+
+    std::vector<Poco::Net::GroupDesc> newsGroups(const std::string &wildMat);
+
+  private:
+    template <typename Result>
+    Result withSession(
+        const std::function<Result(Poco::Net::NNTPClientSession &)> &action);
+
+    NNTPSessionPool m_pool;
+    ArticleCache m_cache;
+    SingleFlight m_flights;
+};
+
+template <typename Result>
+Result Upstream::withSession(
+    const std::function<Result(Poco::Net::NNTPClientSession &)> &action)
+{
+    // A network failure leaves the session in an unknown state; drop it
+    // and retry once on a fresh connection, as idle upstream sessions
+    // are routinely closed by the server (with or without a 400).
+    // Only a clean refusal leaves the session in step with the server.
+    for (int attempt = 0;; ++attempt)
+    {
+        NNTPSessionPool::Lease session = m_pool.acquire();
+        try
+        {
+            return action(*session);
+        }
+        catch (const NNTPException &bang)
+        {
+            if (bang.code() == 411 || bang.code() == 423 || bang.code() == 430)
+                throw;
+            session.invalidate();
+            if (bang.code() != 400 || attempt > 0)
+                throw;
+        }
+        catch (const Poco::Net::NetException &)
+        {
+            session.invalidate();
+            if (attempt > 0)
+                throw;
+        }
+        catch (const Poco::TimeoutException &)
+        {
+            session.invalidate();
+            if (attempt > 0)
+                throw;
+        }
+    }
+}
+
+ArticleCache::Article Upstream::article(const std::string &messageId)
+{
+    if (ArticleCache::Article cached = m_cache.find(messageId))
+        return cached;
+
+    return m_flights.run(
+        messageId,
+        [this, &messageId]
+        {
+            // another flight may have completed between our miss and now
+            if (ArticleCache::Article cached = m_cache.find(messageId))
+                return cached;
+
+            std::string text = withSession<std::string>(
+                [&messageId](Poco::Net::NNTPClientSession &session)
+                { return joinLines(session.articleRaw(messageId)); });
+            return m_cache.add(messageId, std::move(text));
+        });
+}
+
+Poco::Net::ActiveNewsGroup Upstream::group(const std::string &name)
+{
+    return withSession<Poco::Net::ActiveNewsGroup>(
+        [&name](Poco::Net::NNTPClientSession &session)
+        { return session.selectNewsGroup(name); });
+}
+
+std::string Upstream::messageId(const std::string &group, uint_t number)
+{
+    return withSession<std::string>(
+        [&group, number](Poco::Net::NNTPClientSession &session)
+        {
+            if (session.newsGroup() != group)
+                session.selectNewsGroup(group);
+            std::string messageId;
+            if (!session.stat(number, messageId))
+                messageId.clear();
+            return messageId;
+        });
+}
+
+std::vector<Poco::Net::GroupDesc>
+Upstream::newsGroups(const std::string &wildMat)
+{
+    return withSession<std::vector<Poco::Net::GroupDesc>>(
+        [&wildMat](Poco::Net::NNTPClientSession &session)
+        { return session.listNewsGroups(wildMat); });
+}
+
+class ProxyConnection : public Poco::Net::TCPServerConnection
+    /// Serves one reader connection.
+    ///
+    /// Articles are always served by message-id from the cache;
+    /// requests by number are resolved to a message-id with a STAT
+    /// on an upstream session first.
+{
+  public:
+    ProxyConnection(const Poco::Net::StreamSocket &socket, Upstream &upstream)
+        : TCPServerConnection(socket), m_socket(socket), m_upstream(upstream)
+    {
+    }
+
+    void run() override;
+
+  private:
+    enum Part
+    {
+        ARTICLE,
+        HEAD,
+        BODY,
+        STAT
+    };
+
+    bool handle(const std::string &line);
+    void selectGroup(const std::string &name);
+    void retrieve(Part part, const std::string &arg);
+    void listNewsGroups(const std::string &wildMat);
+    void sendMultiLine(const char *begin, const char *end);
+
+    Poco::Net::DialogSocket m_socket;
+    Upstream &m_upstream;
+    std::string m_group;
+    uint_t m_current{};
+};
+
+void ProxyConnection::run()
+{
+    Poco::Util::Application &app = Poco::Util::Application::instance();
+    try
+    {
+        m_socket.sendMessage("201 nntp-proxy ready (no posting)");
+        std::string line;
+        while (m_socket.receiveMessage(line) && handle(line))
+        {
+        }
+    }
+    catch (const Poco::Exception &bang)
+    {
+        app.logger().log(bang);
+    }
+}
+
+bool ProxyConnection::handle(const std::string &line)
+{
+    std::string::size_type pos = line.find(' ');
+    const std::string verb = Poco::toUpper(line.substr(0, pos));
+    const std::string arg =
+        pos == std::string::npos ? std::string() : Poco::trim(line.substr(pos));
+
+    try
+    {
+        if (verb == "QUIT")
+        {
+            m_socket.sendMessage("205 closing connection");
+            return false;
+        }
+        if (verb == "CAPABILITIES")
+        {
+            m_socket.sendMessage("101 capability list follows");
+            m_socket.sendMessage("VERSION 2");
+            m_socket.sendMessage("READER");
+            m_socket.sendMessage("LIST NEWSGROUPS");
+            m_socket.sendMessage(".");
+        }
+        else if (verb == "MODE" && Poco::toUpper(arg) == "READER")
+            m_socket.sendMessage("201 posting prohibited");
+        else if (verb == "GROUP")
+            selectGroup(arg);
+        else if (verb == "ARTICLE")
+            retrieve(ARTICLE, arg);
+        else if (verb == "HEAD")
+            retrieve(HEAD, arg);
+        else if (verb == "BODY")
+            retrieve(BODY, arg);
+        else if (verb == "STAT")
+            retrieve(STAT, arg);
+        else if (verb == "LIST")
+        {
+            pos = arg.find(' ');
+            const std::string keyword = Poco::toUpper(arg.substr(0, pos));
+            if (keyword == "NEWSGROUPS")
+                listNewsGroups(pos == std::string::npos
+                                   ? std::string()
+                                   : Poco::trim(arg.substr(pos)));
+            else
+                m_socket.sendMessage("503 only LIST NEWSGROUPS is supported");
+        }
+        else
+            m_socket.sendMessage("500 unknown command");
+    }
+    catch (const NNTPException &bang)
+    {
+        // relay the upstream refusal (411 no such group, 430 no such
+        // article, ...) when there is one
+        if (bang.code() >= 400 && bang.code() < 600)
+            m_socket.sendMessage(upstreamResponse(bang));
+        else
+            m_socket.sendMessage("403 upstream failure");
+    }
+    catch (const Poco::Exception &)
+    {
+        // network errors and timeouts talking to the upstream server
+        m_socket.sendMessage("403 upstream failure");
+    }
+    return true;
+}
+
+void ProxyConnection::selectGroup(const std::string &name)
+{
+    if (name.empty())
+    {
+        m_socket.sendMessage("501 missing newsgroup name");
+        return;
+    }
+
+    Poco::Net::ActiveNewsGroup group = m_upstream.group(name);
+    m_group = group.newsGroup;
+    m_current = group.lowArticle;
+    m_socket.sendMessage("211 " + std::to_string(group.numArticles) + ' ' +
+                         std::to_string(group.lowArticle) + ' ' +
+                         std::to_string(group.highArticle) + ' ' + m_group);
+}
+
+void ProxyConnection::retrieve(Part part, const std::string &arg)
+{
+    std::string messageId;
+    uint_t number = 0;
+    if (!arg.empty() && arg[0] == '<')
+        messageId = arg;
+    else
+    {
+        if (m_group.empty())
+        {
+            m_socket.sendMessage("412 no newsgroup selected");
+            return;
+        }
+        if (arg.empty())
+            number = m_current;
+        else if (!Poco::NumberParser::tryParseUnsigned(arg, number))
+        {
+            m_socket.sendMessage("501 invalid article number");
+            return;
+        }
+        if (number == 0)
+        {
+            m_socket.sendMessage("420 current article number is invalid");
+            return;
+        }
+        messageId = m_upstream.messageId(m_group, number);
+        if (messageId.empty())
+        {
+            m_socket.sendMessage("423 no article with that number");
+            return;
+        }
+        m_current = number;
+    }
+
+    static const char *const codes[] = {"220 ", "221 ", "222 ", "223 "};
+    const std::string status =
+        codes[part] + std::to_string(number) + ' ' + messageId;
+    if (part == STAT && number != 0)
+    {
+        // the upstream STAT already proved the article exists
+        m_socket.sendMessage(status);
+        return;
+    }
+
+    ArticleCache::Article article = m_upstream.article(messageId);
+    m_socket.sendMessage(status);
+    if (part == STAT)
+        return;
+
+    const char *begin = article->data();
+    const char *end = begin + article->size();
+    std::string::size_type separator = article->find("\r\n\r\n");
+    if (part == HEAD)
+        end = separator == std::string::npos ? end : begin + separator + 2;
+    else if (part == BODY)
+        begin = separator == std::string::npos ? end : begin + separator + 4;
+    sendMultiLine(begin, end);
+}
+
+void ProxyConnection::listNewsGroups(const std::string &wildMat)
+{
+    std::vector<Poco::Net::GroupDesc> groups = m_upstream.newsGroups(wildMat);
+    std::string text;
+    for (const Poco::Net::GroupDesc &group : groups)
+    {
+        text += group.first;
+        text += '\t';
+        text += group.second;
+        text += "\r\n";
+    }
+    m_socket.sendMessage("215 information follows");
+    sendMultiLine(text.data(), text.data() + text.size());
+}
+
+void ProxyConnection::sendMultiLine(const char *begin, const char *end)
+{
+    // dot-stuff into a bounded buffer and send it in large chunks
+    const std::string::size_type chunkSize = 64 * 1024;
+    std::string chunk;
+    chunk.reserve(chunkSize + 1024);
+    bool lineStart = true;
+    for (const char *p = begin; p != end; ++p)
+    {
+        if (lineStart && *p == '.')
+            chunk += '.';
+        chunk += *p;
+        lineStart = *p == '\n';
+        if (lineStart && chunk.size() >= chunkSize)
+        {
+            m_socket.sendBytes(chunk.data(), static_cast<int>(chunk.size()));
+            chunk.clear();
+        }
+    }
+    if (!lineStart)
+        chunk += "\r\n";
+    chunk += ".\r\n";
+    m_socket.sendBytes(chunk.data(), static_cast<int>(chunk.size()));
+}
+
+class ProxyConnectionFactory : public Poco::Net::TCPServerConnectionFactory
+{
+  public:
+    explicit ProxyConnectionFactory(Upstream &upstream) : m_upstream(upstream)
+    {
+    }
+
+    Poco::Net::TCPServerConnection *
+    createConnection(const Poco::Net::StreamSocket &socket) override
+    {
+        return new ProxyConnection(socket, m_upstream);
+    }
+
+  private:
+    Upstream &m_upstream;
+};
+
+class NNTPProxy : public Poco::Util::ServerApplication
+    /// A caching NNTP reader proxy.
+    ///
+    /// Reader connections are answered from a shared in-memory (and
+    /// optionally on-disk) article cache; misses are fetched from the
+    /// upstream server over a small pool of sessions, with concurrent
+    /// misses for the same message-id coalesced into one fetch.
+{
+  protected:
+    void initialize(Application &self) override
+    {
+        loadConfiguration(); // load default configuration files, if present
+        ServerApplication::initialize(self);
+    }
+
+    void defineOptions(Poco::Util::OptionSet &options) override
+    {
+        ServerApplication::defineOptions(options);
+
+        options.addOption(
+            Poco::Util::Option("help", "h", "display help information")
+                .required(false)
+                .repeatable(false));
+        options.addOption(Poco::Util::Option("port", "p",
+                                             "port to accept readers on")
+                              .argument("port")
+                              .binding("NNTPProxy.port"));
+        options.addOption(
+            Poco::Util::Option("upstream", "u", "upstream news server")
+                .argument("host")
+                .binding("NNTPProxy.upstream"));
+        options.addOption(
+            Poco::Util::Option("upstream-port", "", "upstream server port")
+                .argument("port")
+                .binding("NNTPProxy.upstreamPort"));
+        options.addOption(Poco::Util::Option("connections", "c",
+                                             "maximum upstream connections")
+                              .argument("count")
+                              .binding("NNTPProxy.connections"));
+        options.addOption(
+            Poco::Util::Option("cache-size", "s",
+                               "in-memory cache size in megabytes")
+                .argument("mb")
+                .binding("NNTPProxy.cacheSize"));
+        options.addOption(
+            Poco::Util::Option("cache-dir", "d", "on-disk cache directory")
+                .argument("path")
+                .binding("NNTPProxy.cacheDir"));
+        options.addOption(
+            Poco::Util::Option("cache-disk-size", "D",
+                               "on-disk cache size in megabytes, 0 for no limit")
+                .argument("mb")
+                .binding("NNTPProxy.cacheDiskSize"));
+    }
+
+    void handleOption(const std::string &name,
+                      const std::string &value) override
+    {
+        ServerApplication::handleOption(name, value);
+
+        if (name == "help")
+        {
+            m_helpRequested = true;
+            stopOptionsProcessing();
+        }
+    }
+
+    int main(const std::vector<std::string> &) override
+    {
+        if (m_helpRequested)
+        {
+            Poco::Util::HelpFormatter helpFormatter(options());
+            helpFormatter.setCommand(commandName());
+            helpFormatter.setUsage("OPTIONS");
+            helpFormatter.setHeader("A caching NNTP reader proxy.");
+            helpFormatter.format(std::cout);
+            return EXIT_OK;
+        }
+
+        const Poco::UInt16 port =
+            static_cast<Poco::UInt16>(config().getInt("NNTPProxy.port", 1119));
+        const std::string upstreamHost =
+            config().getString("NNTPProxy.upstream", "news.gmane.io");
+        const Poco::UInt16 upstreamPort = static_cast<Poco::UInt16>(
+            config().getInt("NNTPProxy.upstreamPort",
+                            Poco::Net::NNTPClientSession::NNTP_PORT));
+        const int connections = config().getInt("NNTPProxy.connections", 4);
+        const std::size_t cacheBytes =
+            static_cast<std::size_t>(config().getInt("NNTPProxy.cacheSize", 256))
+            * 1024 * 1024;
+        const std::string cacheDirectory =
+            config().getString("NNTPProxy.cacheDir", "");
+        const Poco::UInt64 cacheDiskBytes =
+            static_cast<Poco::UInt64>(config().getInt("NNTPProxy.cacheDiskSize", 4096))
+            * 1024 * 1024;
+        const int maxClients = config().getInt("NNTPProxy.maxClients", 256);
+
+        Upstream upstream(upstreamHost, upstreamPort,
+                          static_cast<std::size_t>(connections), cacheBytes,
+                          cacheDirectory, cacheDiskBytes);
+
+        Poco::Net::TCPServerParams::Ptr params = new Poco::Net::TCPServerParams;
+        params->setMaxThreads(maxClients);
+        params->setMaxQueued(maxClients);
+        Poco::ThreadPool threads(2, maxClients);
+        Poco::Net::ServerSocket socket(port);
+        Poco::Net::TCPServer server(new ProxyConnectionFactory(upstream),
+                                    threads, socket, params);
+        server.start();
+        logger().information("Proxying port " + std::to_string(port) + " to " +
+                             upstreamHost + ':' + std::to_string(upstreamPort));
+        waitForTerminationRequest();
+        server.stop();
+        return EXIT_OK;
+    }
+
+  private:
+    bool m_helpRequested{};
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    NNTPProxy app;
+    return app.run(argc, argv);
+}